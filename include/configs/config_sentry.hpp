@@ -19,13 +19,32 @@ namespace Config
                                                    "CAN_BULLET",
                                                    "CAN_GIMBAL" };
 
+    // 需要打开 CAN FD 的总线，必须是 CanInitList 中的名字
+    const std::vector<std::string> CanFdList = {};
+
+    // DJI 电机指令的发送周期（us），未列出的总线为 1000；底盘控制周期为 2ms，底盘总线按 500Hz 发送即可
+    const std::vector<std::pair<std::string, uint32_t>> CanTxPeriodList = { { "CAN_CHASSIS", 2000 } };
+    // 控制线程算完电流后立即发送（Hardware::DJIMotorManager::commit），CAN_TX_COALESCE_US 内到达的指令合并为一次发送
+    constexpr bool CAN_TX_ON_COMMIT = false;
+    constexpr uint32_t CAN_TX_COALESCE_US = 50;
+
     const std::vector<std::string> SocketInitList = { "AUTO_AIM_CONTROL" };
 
+    // 同机的对端（client 地址为 127.x）已连接 /dev/shm/gkd_<socket 名> 时改用共享内存收发，否则仍使用 UDP
+    constexpr bool SOCKET_SHM = true;
+    // 与 add_client 登记的对端做时钟同步（IO::Clock_ping / Clock_pong）的周期，0 为关闭；对端需忽略不认识的 header
+    constexpr uint32_t CLOCK_SYNC_PERIOD_MS = 100;
+
     const std::vector<std::tuple<std::string, int, int>> SerialInitList = {
         { "/dev/IMU_SMALL_YAW", 115200, 2000 },
         { "/dev/IMU_BIG_YAW", 115200, 2000 }
     };
 
+    // IO 线程模型：false 为每个设备一个阻塞读线程，true 为所有设备共用 IO_REACTOR_THREADS 个 epoll 线程
+    constexpr bool IO_REACTOR = false;
+    constexpr int IO_REACTOR_THREADS = 1;
+    constexpr int IO_REACTOR_CPU = -1;  // reactor 线程绑定的起始 CPU 核，-1 表示不绑定
+
     const std::string rc_controller_serial = "/dev/IMU_BIG_YAW";
 
     const Chassis::ChassisConfig chassis_config = {
@@ -239,6 +258,14 @@ namespace Config
     constexpr uint32_t GIMBAL_INIT_STOP_TIME = 2000;
     constexpr fp32 GIMBAL_INIT_EXP = 0.1f;
 
+    // 自瞄延迟补偿：视觉包带曝光时间戳时，按目标角速度把设定值外推到当前控制周期
+    constexpr uint32_t AUTO_AIM_MAX_PREDICT_MS = 50;  // 最长外推时间
+    constexpr fp32 AUTO_AIM_RATE_FILTER = 0.3f;       // 目标角速度的一阶低通系数
+    // 跟踪器模式（视觉只发送 Robot::ReceiveGimbalPacket）下，裁判系统还没有报告实测初速（Shoot::Bullet_speed_estimator）时
+    // 弹道解算使用的弹速（m/s），以及允许开火的最大瞄准误差（rad）
+    constexpr fp32 AUTO_AIM_BULLET_SPEED = 25.f;
+    constexpr fp32 AUTO_AIM_FIRE_TOLERANCE = 0.01f;
+
     constexpr fp32 FRICTION_MAX_SPEED = 2.5f;
     constexpr fp32 FRICTION_ADD_SPEED = 1.0f;
     constexpr fp32 CONTINUE_TRIGGER_SPEED = 6.f;
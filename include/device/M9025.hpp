@@ -3,6 +3,7 @@
 #include <linux/can.h>
 
 #include "actuator.hpp"
+#include "can.hpp"
 #include "deviece_base.hpp"
 
 namespace Device
@@ -23,7 +24,7 @@ namespace Device
         M9025(const std::string &can_name, int id);
         ~M9025() override = default;
         void set(float x) override;
-        void unpack(const can_frame& frame);
+        void unpack(const can_frame& frame, const IO::Rx_time& stamp);
         void enable();
 
         const int id = 0;
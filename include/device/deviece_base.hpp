@@ -9,16 +9,21 @@ namespace Device
     class DeviceBase
     {
        public:
+        using time_point = typename std::chrono::steady_clock::time_point;
+
         explicit DeviceBase(uint32_t offline_time_t);
         explicit DeviceBase();
         bool offline() const;
+        // 最近一次数据的采样时间（CAN 设备为内核接收时间）
+        time_point last_update() const;
+        // 当前时刻距最近一次采样的时间
+        std::chrono::nanoseconds sample_age() const;
 
        protected:
         void update_time();
+        void update_time(time_point stamp);
 
        private:
-        using time_point = typename std::chrono::system_clock::time_point;
-        
         time_point last_time;
         uint32_t offline_time;
         
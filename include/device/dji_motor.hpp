@@ -3,13 +3,19 @@
 #include <linux/can.h>
 
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <initializer_list>
+#include <ranges>
 #include <stdexcept>
 
 #include "device/deviece_base.hpp"
 #include "actuator.hpp"
 #include "can.hpp"
 #include "dji_motor.hpp"
+#include "latency_histogram.hpp"
+#include "seqlock.hpp"
 #include "types.hpp"
 
 namespace Hardware {
@@ -89,21 +95,32 @@ namespace Hardware {
             float output_linear_velocity = 0.f;     // 输出线速度 (输出角速度 * 半径)
         };
 
+        /** 同一帧反馈得到的一组完整数据 */
+        struct Sample {
+            Message message;
+            Data data;
+            time_point stamp;   // 内核接收时间
+        };
+
         struct Can_info {
             std::string can_name_;
             DJIMotorCanID can_id_ = DJIMotorCanID::ID_NULL;
             int data_bias = 0;
             int callback_flag = 0;
+            int bus_index = -1;     // DJIMotorManager 中所在总线的下标，注册成功后有效
         };
 
         Can_info can_info;
         std::string motor_name_;
+        // 控制线程的本地副本，由 update() 从最新的反馈刷新，只能在拥有该电机的控制线程中读取
         Message motor_measure_{};
         Data data_{};
 
         int motor_id_ = 0;
         bool motor_enabled_ = false;
         int16_t give_current = 0;
+        // 最近一次 set() 时所用反馈的采样年龄，即该电机的 RX 到控制的延迟
+        std::chrono::nanoseconds rx_to_control{};
 
         explicit DJIMotor(const DJIMotorConfig &config);
 
@@ -115,23 +132,98 @@ namespace Hardware {
 
         explicit DJIMotor(DJIMotor &&other) = delete;
 
-        void unpack(const can_frame &frame);
+        void unpack(const can_frame &frame, const IO::Rx_time &stamp);
+
+        // 任意线程可调用，返回同一帧反馈的 Message 与 Data 及其时间戳
+        Sample snapshot() const {
+            return feedback.load();
+        }
+
+        // 在控制周期开始时调用，把最新的反馈刷新到 motor_measure_ 与 data_
+        void update();
 
         void set(float x) override;
 
         void enable();
 
         void set_zero();
+
+       private:
+        // CAN 接收线程是唯一的写者
+        UserLib::Seqlock<Sample> feedback;
     };
 
     namespace DJIMotorManager {
+        constexpr size_t MAX_CAN_BUSES = 8;
+        constexpr size_t FRAMES_PER_BUS = 3;                    // 0x1ff、0x200、0x2ff
+        constexpr size_t MAX_MOTORS_PER_BUS = FRAMES_PER_BUS * 4;
+
+        // 发送计划中的一项：把 current 指向的电流写入 frames_[frame] 的 data[offset]、data[offset + 1]
+        struct TxEntry {
+            uint8_t frame;
+            uint8_t offset;
+            const int16_t *current;
+        };
+
         struct CanBlock {
+            std::string can_name_;
             IO::Can_interface *can_ = nullptr;
             std::vector<DJIMotor *> motors_;
+
+            // 发送计划，注册电机时生成：frames_ 只包含有电机的帧，每个周期只需按 entries_ 写入电流再发送
+            std::array<can_frame, FRAMES_PER_BUS> frames_{};
+            size_t frame_count_ = 0;
+            std::array<TxEntry, MAX_MOTORS_PER_BUS> entries_{};
+            size_t entry_count_ = 0;
+
+            std::chrono::nanoseconds period_ = std::chrono::milliseconds(1);   // 指令发送周期
+            int64_t deadline_ = 0;                  // 下一次发送的绝对时间（CLOCK_MONOTONIC 纳秒），0 表示尚未开始
+            uint64_t overruns_ = 0;                 // 因发送线程被耽误而跳过的周期数
+            UserLib::Jitter_histogram jitter_;      // 每次发送相对截止时间的延迟
+
+            std::atomic<int64_t> committed_ns_{ 0 };     // 最早一次尚未发出的 commit 的时间，0 表示没有
+            UserLib::Histogram<20000> commit_to_tx_;     // commit 到指令发出的延迟，每桶 20us
         };
 
         extern void register_motor(DJIMotor &motor);
 
+        // 设置该总线的指令发送周期，需在 start() 之前调用；未设置的总线为 1ms
+        extern void set_tx_period(const std::string &can_name, std::chrono::nanoseconds period);
+
+        /**
+         * 开启后 commit 立即唤醒发送线程，coalesce 时间内陆续到达的 commit 合并为一次发送；
+         * 没有 commit 的总线仍按周期发送，有 commit 的总线下一次周期发送顺延一个周期
+         * 需在 start() 之前调用
+         */
+        extern void set_tx_on_commit(bool enable, std::chrono::nanoseconds coalesce);
+
+        // 按总线下标的位掩码提交，bit i 对应第 i 条总线
+        extern void commit_buses(uint32_t mask);
+
+        inline uint32_t bus_mask(const DJIMotor &motor) {
+            return motor.can_info.bus_index < 0 ? 0 : 1u << motor.can_info.bus_index;
+        }
+
+        // 控制线程算完一组电机的 give_current 后调用，标记所在总线有新指令，并用于统计 commit 到发出的延迟
+        inline void commit(std::initializer_list<const DJIMotor *> motors) {
+            uint32_t mask = 0;
+            for (const auto motor : motors) {
+                mask |= bus_mask(*motor);
+            }
+            commit_buses(mask);
+        }
+
+        // 同上，一次提交一组电机（如底盘的全部轮子），每条总线只唤醒一次
+        template<std::ranges::input_range Range>
+            requires std::same_as<std::remove_cvref_t<std::ranges::range_value_t<Range>>, DJIMotor>
+        void commit(const Range &motors) {
+            uint32_t mask = 0;
+            for (const auto &motor : motors) {
+                mask |= bus_mask(motor);
+            }
+            commit_buses(mask);
+        }
+
         extern void start();
     }
 }
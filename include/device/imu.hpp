@@ -1,6 +1,7 @@
 #pragma once
 
 #include "device/deviece_base.hpp"
+#include "history.hpp"
 #include "memory"
 #include "robot.hpp"
 #include "types.hpp"
@@ -19,10 +20,31 @@ namespace Device
         fp32 pitch_rate = 0;
         fp32 roll_rate = 0;
 
+        struct Attitude
+        {
+            fp32 yaw;
+            fp32 pitch;
+            fp32 roll;
+        };
+        // 1kHz 下约保存 0.5s
+        using Attitude_history = UserLib::History<Attitude, 512>;
+
         void enable();
         void unpack(const Types::ReceivePacket_IMU& pkg);
 
+        /**
+         * 查询 steady_clock 时间戳（纳秒）处的姿态，在相邻两个样本之间插值，可在任意线程调用
+         * 晚于最新样本时返回最新样本，早于保存范围时返回 false
+         */
+        bool attitude_at(int64_t stamp_ns, Attitude& attitude) const;
+
+        // 最新姿态样本及其时间戳
+        bool latest(Attitude_history::Entry& entry) const {
+            return history.latest(entry);
+        }
+
        private:
+        Attitude_history history;
         std::string serial_name;
         std::shared_ptr<Robot::Robot_set> robot_set;
     };
@@ -30,11 +30,11 @@ namespace Device
         int rx_len_;
 
        private:
-        int unpack(uint8_t *rx_data);
+        // available 为 rx_data 之后窗口内剩余的字节数，帧不完整时返回 -1
+        int unpack(uint8_t *rx_data, int available);
         void publishCapacityData();
 
-        const int k_frame_length_ = 128, k_header_length_ = 5, k_cmd_id_length_ = 2,
-                  k_tail_length_ = 2;
+        const int k_header_length_ = 5, k_cmd_id_length_ = 2, k_tail_length_ = 2;
         const int k_unpack_buffer_length_ = 256;
         uint8_t unpack_buffer_[256]{};
     };
@@ -24,5 +24,7 @@ namespace Gimbal
         uint8_t header;
         std::string auto_aim_ip;
         int auto_aim_port;
+        // 视觉只发送跟踪器状态（Robot::ReceiveGimbalPacket）时使用的 header，由控制程序每个周期解算弹道
+        uint8_t tracker_header = 0x5A;
     };
 }  // namespace Gimbal
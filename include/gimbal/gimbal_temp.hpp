@@ -2,10 +2,12 @@
 
 #include <memory>
 
+#include "bullet_solver.hpp"
 #include "device/imu.hpp"
 #include "dji_motor.hpp"
 #include "gimbal/gimbal_config.hpp"
 #include "robot.hpp"
+#include "seqlock.hpp"
 #include "shoot.hpp"
 
 namespace Gimbal
@@ -21,6 +23,11 @@ namespace Gimbal
         [[noreturn]] void task();
         void update_data();
 
+       private:
+        void update_aim_target(const Robot::Auto_aim_control& vc);
+        void predict_aim();
+        bool solve_tracker(int64_t now_ns);
+
        public:
         uint32_t init_stop_times = 0;
 
@@ -51,6 +58,27 @@ namespace Gimbal
 
         std::chrono::_V2::steady_clock::time_point receive_auto_aim;
 
+        // 最近一次带曝光时间戳的视觉设定值，以及由相邻两次设定值估计的目标角速度（rad/s）
+        struct Aim_target
+        {
+            int64_t capture_ns;
+            fp32 yaw;
+            fp32 pitch;
+            fp32 yaw_rate;
+            fp32 pitch_rate;
+        };
+        UserLib::Seqlock<Aim_target> aim_target;
+        int64_t applied_capture_ns = 0;  // 控制线程最近一次使用的视觉帧，用于统计曝光到电机控制的延迟
+
+        // 跟踪器模式：视觉只发送目标状态，控制线程每个周期把目标预测到当前时刻并解算弹道
+        struct Tracker_state
+        {
+            Robot::ReceiveGimbalPacket target;  // capture_ns 已换算到本地时钟
+            int64_t received_ns;
+        };
+        UserLib::Seqlock<Tracker_state> tracker;
+        Control::BulletSolver bullet_solver;
+
     };
 
 }  // namespace Gimbal
@@ -9,33 +9,144 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
+#include <mutex>
+#include <vector>
 
 #include "io_callback.hpp"
 #include "types.hpp"
+#include "utils.hpp"
 
 namespace IO
 {
-    class Can_interface : public Callback_key<uint32_t, can_frame>
+    /**
+     * 单条总线的收发计数，只在收发线程中以 relaxed 方式自增，读取端不加锁
+     */
+    struct Can_stats
+    {
+        std::atomic<uint64_t> rx_frames{ 0 };
+        std::atomic<uint64_t> rx_syscalls{ 0 };
+        std::atomic<uint64_t> tx_frames{ 0 };
+        std::atomic<uint64_t> tx_syscalls{ 0 };
+        std::atomic<uint64_t> rx_unhandled{ 0 };  // 通过了内核过滤但没有回调处理的帧
+        std::atomic<uint64_t> dispatch_ns{ 0 };   // 回调分发累计耗时
+        std::atomic<uint64_t> rx_errors{ 0 };     // recvmmsg 失败次数
+        std::atomic<uint64_t> tx_errors{ 0 };     // write/sendmmsg 失败次数（如 ENOBUFS，发送队列溢出）
+        std::atomic<uint64_t> tx_dropped{ 0 };    // 因发送失败而没有发出的帧
+        std::atomic<uint64_t> err_frames{ 0 };    // 控制器上报的错误帧 (CAN_ERR_FLAG)
+        std::atomic<uint64_t> bus_off{ 0 };       // 进入 bus-off 的次数
+        std::atomic<bool> bus_off_state{ false }; // 当前是否处于 bus-off，控制器重启后清除
+    };
+
+    /**
+     * 网卡层面的累计计数，读取自 /sys/class/net/<name>/statistics，包含被过滤和其他进程的帧
+     */
+    struct Iface_stats
+    {
+        uint64_t rx_packets = 0;
+        uint64_t rx_bytes = 0;
+        uint64_t tx_packets = 0;
+        uint64_t tx_bytes = 0;
+    };
+
+    // 帧的内核接收时间，已换算到 steady_clock
+    using Rx_time = std::chrono::steady_clock::time_point;
+
+    class Can_interface : public Callback_table<CAN_SFF_MASK + 1, can_frame, Rx_time>
     {
        public:
+        // 单次 recvmmsg/sendmmsg 最多处理的帧数
+        constexpr static int BATCH_SIZE = 32;
+        // 总线波特率，只用于估算负载率，DJI 电调总线固定 1Mbps
+        constexpr static uint32_t BITRATE = 1000000;
+
         Can_interface(const std::string &name);
         ~Can_interface();
         bool send(const can_frame &frame);
+        // 一次系统调用发送多帧（如同一总线上的 0x1FF/0x200/0x2FF）
+        bool send(const can_frame *frames, size_t n);
         bool task();
         void init(const char *can_channel);
 
+        // reactor 模式下使用：fd 可读时非阻塞地取出并分发所有已到达的帧
+        bool on_readable();
+        int fd() const {
+            return soket_id;
+        }
+
+        /**
+         * 注册回调的同时把 key 加入内核 CAN_RAW_FILTER，未注册的 ID 在内核中直接丢弃
+         */
+        template<typename F>
+        void register_callback_key(const uint32_t key, F &&fun) {
+            Callback_table::register_callback_key(key, std::forward<F>(fun));
+            add_filter(key);
+        }
+
+        // 网卡自 init 以来的收发统计，读取自 sysfs
+        Iface_stats iface_stats() const;
+
+        /**
+         * 打开 CAN_RAW_FD_FRAMES，之后可以收发 canfd_frame
+         * 经典帧的收发（如 DJIMotorManager）不受影响，同一条总线上两种帧可以共存
+         * 需要网卡本身已配置为 FD 模式（ip link set canX type can ... fd on）
+         */
+        bool enable_fd();
+        bool fd_enabled() const {
+            return fd_mode;
+        }
+        bool send(const canfd_frame &frame);
+
+        // 回放一帧记录下来的 can_frame / canfd_frame，走与接收时相同的回调分发
+        void replay(const uint8_t *data, size_t len);
+
+        /**
+         * 注册 CAN FD 帧的回调，与经典帧的回调相互独立
+         */
+        template<typename F>
+        void register_fd_callback_key(const uint32_t key, F &&fun) {
+            if (!fd_mode) {
+                LOG_ERR("CAN error[%s]: register FD callback 0x%x on a classic interface\n", name.c_str(), key);
+            }
+            fd_callbacks.register_callback_key(key, std::forward<F>(fun));
+            add_filter(key);
+        }
+
+       private:
+        int receive(int flags);
+        void add_filter(uint32_t key);
+        void apply_filter();
+        uint64_t read_iface_stat(const char *stat) const;
+        void on_error_frame(const can_frame &frame);
+
        private:
         sockaddr_can *addr;
-        can_frame frame_r;
+        // 打开 FD 后内核可能送来 CAN_MTU 或 CANFD_MTU 大小的帧，按实际长度区分
+        union Rx_frame
+        {
+            can_frame classic;
+            canfd_frame fd;
+        } frame_r[BATCH_SIZE];
+        iovec rx_iov[BATCH_SIZE];
+        mmsghdr rx_msgs[BATCH_SIZE];
+        alignas(cmsghdr) uint8_t rx_control[BATCH_SIZE][CMSG_SPACE(sizeof(timespec))];
         ifreq *ifr;
         Types::debug_info_t *debug;
         int soket_id;
         bool init_flag;
+        bool fd_mode = false;
+        Callback_table<CAN_SFF_MASK + 1, canfd_frame, Rx_time> fd_callbacks;
+        std::mutex filter_lock;
+        std::vector<can_filter> filters;
+        Iface_stats iface_base;
+        int record_source = -1;
 
        public:
         std::string name;
+        Can_stats stats;
     };
 
 }  // namespace IO
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "seqlock.hpp"
+
+namespace IO
+{
+    /**
+     * 时钟同步包，header 与其他包不能重复
+     * 控制程序定期向每个 client 发送 Clock_ping；对端收到后原样带回 client、seq、t1，
+     * 并填入自己收到 ping 的时间 t2 与发出 pong 的时间 t3（对端的单调时钟，纳秒）
+     */
+    constexpr uint8_t CLOCK_PING_HEADER = 0x7C;
+    constexpr uint8_t CLOCK_PONG_HEADER = 0x7D;
+
+    struct Clock_ping
+    {
+        uint8_t header = CLOCK_PING_HEADER;
+        uint8_t client;  // 被同步的 client 的 header
+        uint16_t seq;
+        int64_t t1;  // 控制程序发出时间
+    } __attribute__((packed));
+
+    struct Clock_pong
+    {
+        uint8_t header = CLOCK_PONG_HEADER;
+        uint8_t client;
+        uint16_t seq;
+        int64_t t1;
+        int64_t t2;  // 对端收到 ping 的时间
+        int64_t t3;  // 对端发出 pong 的时间
+    } __attribute__((packed));
+
+    /**
+     * NTP 式的时钟偏移与漂移估计
+     * 每次往返得到一个偏移样本 offset = ((t2 - t1) + (t3 - t4)) / 2 与往返延迟 delay = (t4 - t1) - (t3 - t2)，
+     * 只采用延迟接近最小值的样本（排队延迟大的样本偏移误差也大），对其做最小二乘直线拟合得到偏移与漂移
+     * 样本由接收线程写入，估计值通过 Seqlock 发布，可在任意线程无锁读取
+     */
+    class Clock_sync
+    {
+       public:
+        constexpr static size_t SAMPLES = 32;
+
+        struct Estimate
+        {
+            bool valid;
+            int64_t local_ref;   // 拟合的参考点（本地时间）
+            int64_t offset_ref;  // 参考点处的偏移：对端时间 - 本地时间
+            double drift;        // 偏移随本地时间的变化率，乘 1e6 即 ppm
+            int64_t min_delay;   // 最近样本中的最小往返延迟
+        };
+
+        // 每收到一个 pong 调用一次，t4 为本地收到 pong 的时间
+        void add_sample(int64_t t1, int64_t t2, int64_t t3, int64_t t4);
+
+        Estimate estimate() const {
+            return published.load();
+        }
+
+        /**
+         * 把对端时间映射到本地 steady_clock，还没有有效估计时原样返回（认为两端是同一个时钟）
+         */
+        int64_t to_local(int64_t remote_ns) const;
+
+       private:
+        struct Sample
+        {
+            int64_t local;  // 往返中点的本地时间
+            int64_t offset;
+            int64_t delay;
+        };
+
+        std::mutex lock;  // 只在多个接收线程（UDP 与共享内存）同时收到 pong 时竞争
+        Sample samples[SAMPLES]{};
+        size_t count = 0;
+        UserLib::Seqlock<Estimate> published;
+    };
+}  // namespace IO
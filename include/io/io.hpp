@@ -6,6 +6,8 @@
 #include <utils.hpp>
 
 #include "can.hpp"
+#include "reactor.hpp"
+#include "recorder.hpp"
 
 using CAN = IO::Can_interface;
 
@@ -52,10 +54,31 @@ namespace IO
                 throw std::runtime_error("IO error: double register device named " + device.name);
             }
             p = &device;
-            io_handles.emplace_back(std::thread([&]() { device.task(); }));
+            if (replaying) {
+                return;
+            }
+            if (mode == Mode::REACTOR && device.fd() >= 0) {
+                reactor.add(device.fd(), device.name, [&]() { return device.on_readable(); });
+            } else {
+                io_handles.emplace_back(std::thread([&]() { device.task(); }));
+            }
+        }
+
+        auto begin() const {
+            return data.begin();
+        }
+
+        auto end() const {
+            return data.end();
         }
     };
 
+    // report_task 每秒刷新的统计文件，每行 "<key> <value>"，可直接 cat 查询
+    constexpr const char *STATS_FILE = "/tmp/gkd_io_stats";
+
+    // 每秒统计各 IO 的收发、错误以及进程的上下文切换次数，写入 STATS_FILE，debug 模式下同时通过 logger 上报
+    [[noreturn]] void report_task();
+
     template<typename T>
     IO<T> io;
 }  // namespace IO
@@ -3,8 +3,13 @@
 //
 #pragma once
 
+#include "array"
+#include "cstddef"
+#include "cstdint"
 #include "functional"
 #include "map"
+#include "new"
+#include "type_traits"
 
 namespace IO {
 
@@ -104,6 +109,40 @@ namespace IO {
         std::function<void(const Head &)> callback_fun;
     };
 
+    /** delegate define **/
+    /**
+     * 不分配内存的回调，可调用对象直接存放在内部缓冲区中，调用时只有一次间接跳转
+     * 只接受可平凡复制且不超过两个指针大小的可调用对象（如只捕获 this 或一个引用的 lambda）
+     * @tparam Args 回调参数类型
+     */
+    template<typename ...Args>
+    class Delegate {
+       public:
+        Delegate() = default;
+
+        template<typename F>
+            requires(!std::is_same_v<std::decay_t<F>, Delegate>)
+        Delegate(F &&fun) {
+            using Fn = std::decay_t<F>;
+            static_assert(sizeof(Fn) <= sizeof(storage), "Delegate: callable is too large");
+            static_assert(std::is_trivially_copyable_v<Fn>, "Delegate: callable must be trivially copyable");
+            ::new (static_cast<void *>(storage)) Fn(std::forward<F>(fun));
+            invoke = [](void *obj, const Args &... args) { (*static_cast<Fn *>(obj))(args...); };
+        }
+
+        void operator()(const Args &... args) {
+            invoke(storage, args...);
+        }
+
+        explicit operator bool() const {
+            return invoke != nullptr;
+        }
+
+       private:
+        alignas(void *) std::byte storage[2 * sizeof(void *)]{};
+        void (*invoke)(void *, const Args &...) = nullptr;
+    };
+
     /** callback key define**/
     template<typename Key, typename ...Args>
     class Callback_key {
@@ -118,8 +157,53 @@ namespace IO {
             callback_map[key] = fun;
         }
 
+        bool has_callback_key(const Key &key) const {
+            return callback_map.count(key) != 0;
+        }
+
        private:
         std::map<Key, std::function<void(const Args &...)>> callback_map;
     };
 
+    /** callback table define**/
+    /**
+     * 以 key 直接下标索引的回调表，适用于取值稠密的 key（如 11 位标准 CAN ID）
+     * 分发只需一次取址和一次间接调用；不小于 Size 的 key 退回到 map 中查找
+     * @tparam Size 表的大小
+     * @tparam Args 回调参数类型
+     */
+    template<size_t Size, typename ...Args>
+    class Callback_table {
+       public:
+        bool callback_key(const uint32_t key, const Args &... args) {
+            if (key < Size) {
+                auto &fun = callback_table[key];
+                if (fun) {
+                    fun(args...);
+                    return true;
+                }
+                return false;
+            }
+            auto p = sparse_map.find(key);
+            if (p != sparse_map.end()) {
+                p->second(args...);
+                return true;
+            }
+            return false;
+        }
+
+        template<typename F>
+        void register_callback_key(const uint32_t key, F &&fun) {
+            if (key < Size) {
+                callback_table[key] = Delegate<Args...>(std::forward<F>(fun));
+            } else {
+                sparse_map[key] = Delegate<Args...>(std::forward<F>(fun));
+            }
+        }
+
+       private:
+        std::array<Delegate<Args...>, Size> callback_table{};
+        std::map<uint32_t, Delegate<Args...>> sparse_map;
+    };
+
 }  // namespace Hardware
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+
+namespace IO
+{
+    /** packet define **/
+    /**
+     * 把包 ID 与包类型绑定在一起
+     * @tparam Id 帧中的包 ID
+     * @tparam T 包体类型，按字节原样拷贝，必须是可平凡复制的 packed 结构体
+     */
+    template<uint8_t Id, typename T>
+    struct Packet {
+        static_assert(std::is_trivially_copyable_v<T>, "Packet: payload must be trivially copyable");
+        static_assert(sizeof(T) <= UINT8_MAX, "Packet: payload does not fit in the length field");
+
+        constexpr static uint8_t id = Id;
+        using type = T;
+    };
+
+    /** packet registry define **/
+    /**
+     * 编译期的包注册表：ID 到包大小与分发函数的映射都在编译期生成为 256 项的表，
+     * 分发时只有一次查表和一次间接调用，新增包类型只需在类型列表中加一项
+     * 设备通过 register_callback<T> 按包类型订阅
+     * @tparam Packets Packet<Id, T> 列表，ID 与类型都不能重复
+     */
+    template<typename... Packets>
+    class Packet_registry {
+        template<typename T, typename Head, typename... Tail>
+        constexpr static size_t index_of() {
+            if constexpr (std::is_same_v<T, typename Head::type>) {
+                return 0;
+            } else {
+                static_assert(sizeof...(Tail) > 0, "Packet_registry: type is not registered");
+                return 1 + index_of<T, Tail...>();
+            }
+        }
+
+        constexpr static bool unique_ids() {
+            std::array<bool, 256> used{};
+            for (uint8_t id : { Packets::id... }) {
+                if (used[id]) {
+                    return false;
+                }
+                used[id] = true;
+            }
+            return true;
+        }
+        static_assert(unique_ids(), "Packet_registry: duplicated packet id");
+
+        using Handler = void (*)(Packet_registry &, const uint8_t *);
+
+        template<typename P>
+        static void handle(Packet_registry &self, const uint8_t *data) {
+            typename P::type pkg;
+            memcpy(&pkg, data, sizeof(pkg));
+            auto &fun = std::get<index_of<typename P::type, Packets...>()>(self.callbacks);
+            if (fun) {
+                fun(pkg);
+            }
+        }
+
+        constexpr static std::array<uint8_t, 256> sizes = [] {
+            std::array<uint8_t, 256> table{};
+            ((table[Packets::id] = sizeof(typename Packets::type)), ...);
+            return table;
+        }();
+
+        constexpr static std::array<Handler, 256> handlers = [] {
+            std::array<Handler, 256> table{};
+            ((table[Packets::id] = &handle<Packets>), ...);
+            return table;
+        }();
+
+       public:
+        // 包体大小，未注册的 ID 返回 0
+        constexpr static size_t packet_size(uint8_t id) {
+            return sizes[id];
+        }
+
+        template<typename T>
+        void register_callback(const std::function<void(const T &)> &fun) {
+            std::get<index_of<T, Packets...>()>(callbacks) = fun;
+        }
+
+       protected:
+        // data 至少有 packet_size(id) 个字节，未注册的 ID 直接忽略
+        void dispatch_packet(uint8_t id, const uint8_t *data) {
+            if (auto handler = handlers[id]) {
+                handler(*this, data);
+            }
+        }
+
+       private:
+        std::tuple<std::function<void(const typename Packets::type &)>...> callbacks;
+    };
+}  // namespace IO
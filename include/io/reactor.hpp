@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace IO
+{
+    enum class Mode
+    {
+        THREAD_PER_DEVICE,  // 每个设备一个阻塞读线程
+        REACTOR             // 所有设备的 fd 交给 Reactor 统一 epoll
+    };
+
+    /**
+     * 基于 epoll 的 IO 复用线程（池）
+     * 被管理的设备需要提供 fd() 以及不会阻塞的 on_readable()，后者在 fd 可读时被调用，
+     * 返回 Status::ERROR 时该 fd 会被移出 epoll
+     */
+    class Reactor
+    {
+       public:
+        ~Reactor();
+        /**
+         * @param thread_num 线程数，大于 1 时使用 EPOLLONESHOT 保证同一个 fd 同时只被一个线程处理
+         * @param cpu 绑定的起始 CPU 核，第 i 个线程绑定在 cpu + i 上，小于 0 时不绑定
+         */
+        void start(int thread_num, int cpu);
+        void add(int fd, const std::string &name, const std::function<bool()> &handler);
+
+       private:
+        struct Handler
+        {
+            int fd;
+            std::string name;
+            std::function<bool()> fun;
+        };
+
+        [[noreturn]] void task();
+
+        int epoll_fd = -1;
+        bool oneshot = false;
+        std::mutex handlers_lock;
+        std::vector<std::unique_ptr<Handler>> handlers;
+        std::vector<std::thread> threads;
+    };
+
+    inline Mode mode = Mode::THREAD_PER_DEVICE;
+    inline Reactor reactor;
+}  // namespace IO
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace IO
+{
+    enum class Source_type : uint8_t
+    {
+        CAN = 0,     // 原始 can_frame / canfd_frame
+        SERIAL = 1,  // 包 ID + 包体
+        SOCKET = 2   // 原始 UDP 数据包
+    };
+
+    /**
+     * 飞行记录仪
+     * 把各 IO 收到的原始数据连同 steady_clock 时间戳写入预分配的 mmap 环形文件，写满后覆盖最旧的记录
+     * 文件按 64 字节的 slot 划分，一条记录占用若干个连续的 slot，通过原子地推进 slot 计数来分配，
+     * 多个接收线程可以同时写入而不需要加锁
+     */
+    class Recorder
+    {
+       public:
+        constexpr static size_t SLOT_SIZE = 64;
+        constexpr static size_t MAX_SOURCES = 32;
+        constexpr static size_t MAX_RECORD = 512;        // 单条记录的最大长度
+        constexpr static size_t DEFAULT_SIZE = 64 << 20;  // 默认文件大小 64MiB
+
+        ~Recorder();
+        bool open(const std::string &path, size_t size = DEFAULT_SIZE);
+        bool enabled() const {
+            return header != nullptr;
+        }
+
+        /**
+         * 在接口构造时登记数据来源，未开启记录时返回 -1
+         */
+        int add_source(Source_type type, const std::string &name);
+
+        /**
+         * 追加一条记录，可在多个线程中并发调用
+         */
+        void record(int source, const void *data, size_t len);
+
+        /**
+         * 在独立线程中把记录按原始节奏送回各接口的回调分发
+         * @param speed 回放倍速，小于等于 0 时不等待，尽快回放
+         */
+        static void start_replay(const std::string &path, double speed);
+
+       public:
+        struct Source
+        {
+            Source_type type;
+            char name[31];
+        };
+
+        struct File_header
+        {
+            char magic[8];
+            uint64_t slot_count;
+            std::atomic<uint64_t> next_slot;  // 已分配的 slot 总数
+            uint32_t source_count;
+            Source sources[MAX_SOURCES];
+        };
+
+        // 记录的第一个 slot 以 Record_head 开头，其后是数据
+        struct Record_head
+        {
+            int64_t time_ns;
+            uint16_t len;
+            uint8_t source;
+            uint8_t reserved[5];
+        };
+
+        struct Slot
+        {
+            // slot 序号 << 2 | 类型，数据写完后最后写入，用于判断 slot 是否完整以及是否已被覆盖
+            std::atomic<uint64_t> tag;
+            uint8_t data[SLOT_SIZE - sizeof(uint64_t)];
+        };
+
+        constexpr static uint64_t TAG_HEAD = 1;
+        constexpr static uint64_t TAG_BODY = 2;
+        constexpr static size_t HEAD_PAYLOAD = sizeof(Slot::data) - sizeof(Record_head);
+        constexpr static size_t HEADER_SIZE = 4096;
+
+        static size_t slots_for(size_t len) {
+            return len <= HEAD_PAYLOAD ? 1 : 1 + (len - HEAD_PAYLOAD + sizeof(Slot::data) - 1) / sizeof(Slot::data);
+        }
+
+       private:
+        File_header *header = nullptr;
+        Slot *slots = nullptr;
+        size_t map_size = 0;
+    };
+
+    inline Recorder recorder;
+    // 回放模式下各接口不打开硬件，也不启动接收线程，数据全部来自记录文件
+    inline bool replaying = false;
+}  // namespace IO
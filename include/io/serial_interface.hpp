@@ -1,39 +1,97 @@
 #ifndef __SERIAL_INTERFACE__
 #define __SERIAL_INTERFACE__
+#include <atomic>
+#include <cstdint>
 #include <functional>
 
-#include "io_callback.hpp"
+#include "packet_registry.hpp"
 #include "serial/serial.h"
 #include "types.hpp"
 #include "utils.hpp"
 
 namespace IO
 {
+    /**
+     * 串口收包计数，只在接收线程中以 relaxed 方式自增，读取端不加锁
+     */
+    struct Serial_stats
+    {
+        std::atomic<uint64_t> rx_bytes{ 0 };
+        std::atomic<uint64_t> read_syscalls{ 0 };
+        std::atomic<uint64_t> packets{ 0 };
+        std::atomic<uint64_t> skipped_bytes{ 0 };  // 重新同步帧头时丢弃的字节
+        std::atomic<uint64_t> parse_ns{ 0 };       // 从读到数据到包分发完成的累计耗时
+        std::atomic<uint64_t> crc_errors{ 0 };     // 帧头 CRC8 或整帧 CRC16 校验失败
+        std::atomic<uint64_t> length_errors{ 0 };  // 长度字段与该 id 的包大小不符
+        std::atomic<uint64_t> unknown_ids{ 0 };    // 校验通过但 id 未知的帧
+        std::atomic<uint64_t> dropped{ 0 };        // 按序号推算出的丢包数
+        std::atomic<uint64_t> legacy_packets{ 0 }; // 第 1 版（无校验）帧
+    };
 
-    class Serial_interface : serial::Serial, public Callback<Types::ReceivePacket_IMU, Types::ReceivePacket_RC_CTRL>
+    /**
+     * 下位机发送的所有包类型，新增包类型只需在这里加一项 Packet<ID, 类型>
+     */
+    using Serial_packets = Packet_registry<
+        Packet<1, Types::ReceivePacket_IMU>,
+        Packet<2, Types::ReceivePacket_RC_CTRL>>;
+
+    class Serial_interface : serial::Serial, public Serial_packets
     {
        public:
         Serial_interface(std::string port_name, int baudrate, int simple_timeout);
         Serial_interface() = delete;
         ~Serial_interface();
         void task();
+
+        // reactor 模式下使用：读出所有已到达的字节并分发其中完整的包
+        bool on_readable();
+        int fd() const {
+            return serial_fd;
+        }
+
+        // 回放一条记录（包 ID + 包体），走与接收时相同的回调分发
+        void replay(const uint8_t *data, size_t len);
+
         template<typename T>
         void send(T val) {
            write(&val, sizeof(T));
         }
 
        private:
+        // 接收环形缓冲区大小，必须是 2 的幂
+        constexpr static size_t RX_SIZE = 512;
+
         inline void enumerate_ports();
-        inline int unpack(uint8_t pkg_id);
+        static int find_fd(const std::string &port_name);
+        void dispatch(uint8_t pkg_id, const uint8_t *data);
+        // 把已到达的字节读入环形缓冲区，返回读到的字节数
+        // after_ready 表示刚等到可读：此时读不到数据说明设备已断开，与读出错一样抛出 serial::IOException
+        ssize_t fill(bool after_ready = false);
+        // 在环形缓冲区中寻找帧头并原地分发所有完整且校验通过的包，帧格式见 serial_protocol.hpp
+        void parse();
+        // 解析 rx_head 处的帧：返回帧长度，数据不完整时返回 0，不是合法的帧时返回 -1
+        ssize_t parse_frame(uint64_t &packets);
+        ssize_t parse_legacy_frame(uint64_t &packets);
+        // 返回 rx_head + offset 处连续的 len 个字节，跨越缓冲区末尾时先拼接到 wrap_buffer
+        const uint8_t *contiguous(size_t offset, size_t len);
 
        public:
-        Types::ReceivePacket_IMU imu_pkg;
-        Types::ReceivePacket_RC_CTRL rc_pkg;
         std::string name;
+        Serial_stats stats;
 
        private:
-        uint8_t buffer[256];
-        uint16_t header;
+        int serial_fd = -1;
+        // rx_head / rx_tail 单调递增，取下标时与 RX_SIZE - 1 相与
+        uint8_t rx_ring[RX_SIZE];
+        size_t rx_head = 0;
+        size_t rx_tail = 0;
+        // 跨越环形缓冲区末尾的包先拼接到这里再分发
+        uint8_t wrap_buffer[RX_SIZE];
+        // 收到过第 2 版的帧后不再接受第 1 版，避免把 payload 中的 0xAA55 误认为帧头
+        bool legacy_allowed = true;
+        bool seq_valid = false;
+        uint8_t last_seq = 0;
+        int record_source = -1;
     };
 }  // namespace IO
 #endif
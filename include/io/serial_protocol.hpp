@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "protocol.hpp"
+
+namespace IO::Serial_protocol
+{
+    /**
+     * 下位机串口帧（第 2 版）
+     * | SOF | version | id | len | seq | CRC8 | payload(len) | CRC16 |
+     * CRC8 校验前 5 个字节，CRC16 校验帧头与 payload，与裁判系统使用相同的 CRC 表
+     * 第 1 版只有 0xAA55 帧头与 id，没有长度与校验，仍然兼容，但一旦在某个串口上收到第 2 版的帧就不再接受
+     */
+    constexpr uint8_t SOF = 0xA5;
+    constexpr uint8_t VERSION = 2;
+    constexpr uint16_t LEGACY_HEADER = 0xAA55;
+
+    struct Frame_header
+    {
+        uint8_t sof;
+        uint8_t version;
+        uint8_t id;
+        uint8_t len;
+        uint8_t seq;
+        uint8_t crc8;
+    } __attribute__((packed));
+
+    constexpr size_t HEADER_SIZE = sizeof(Frame_header);
+    constexpr size_t TAIL_SIZE = sizeof(uint16_t);
+    constexpr size_t LEGACY_HEADER_SIZE = 3;
+
+    inline uint8_t crc8(const uint8_t *data, size_t len) {
+        uint8_t crc = Referee::kCrc8Init;
+        while (len--) {
+            crc = Referee::kCrc8Table[crc ^ *data++];
+        }
+        return crc;
+    }
+
+    inline uint16_t crc16(const uint8_t *data, size_t len) {
+        uint16_t crc = Referee::kCrc16Init;
+        while (len--) {
+            crc = (crc >> 8) ^ Referee::wCRC_table[(crc ^ *data++) & 0xff];
+        }
+        return crc;
+    }
+
+    /**
+     * 把 payload 编码为一帧，out 至少需要 HEADER_SIZE + len + TAIL_SIZE 字节，返回帧长度
+     * 供下位机模拟器与测试使用
+     */
+    inline size_t encode(uint8_t *out, uint8_t id, uint8_t seq, const void *payload, uint8_t len) {
+        Frame_header header{ .sof = SOF, .version = VERSION, .id = id, .len = len, .seq = seq, .crc8 = 0 };
+        memcpy(out, &header, HEADER_SIZE);
+        out[HEADER_SIZE - 1] = crc8(out, HEADER_SIZE - 1);
+        memcpy(out + HEADER_SIZE, payload, len);
+        uint16_t crc = crc16(out, HEADER_SIZE + len);
+        out[HEADER_SIZE + len] = crc & 0xff;
+        out[HEADER_SIZE + len + 1] = crc >> 8;
+        return HEADER_SIZE + len + TAIL_SIZE;
+    }
+}  // namespace IO::Serial_protocol
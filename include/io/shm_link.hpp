@@ -0,0 +1,213 @@
+#pragma once
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+namespace IO
+{
+    /**
+     * 同一台机器上两个进程之间的共享内存链路，用于代替回环 UDP
+     * 段内有两个方向相反的单生产者单消费者环形队列，每条消息占一个定长 slot
+     * 消费者队列为空时在 head 上 futex 等待，生产者只在对方正在等待时才 futex 唤醒，
+     * 因此在收发都繁忙时不需要任何系统调用
+     * 只依赖系统头文件，视觉程序可以直接包含本文件，以 Role::VISION 打开同名的段
+     */
+    class Shm_link
+    {
+       public:
+        enum class Role
+        {
+            ROBOT,  // 控制程序，负责创建段
+            VISION  // 视觉程序，打开已有的段
+        };
+
+        constexpr static uint32_t MAGIC = 0x474b4431;  // "GKD1"
+        constexpr static size_t SLOT_SIZE = 256;
+        constexpr static size_t SLOTS = 64;
+        constexpr static size_t MAX_MESSAGE = SLOT_SIZE - sizeof(uint32_t);
+
+        struct Slot
+        {
+            uint32_t len;
+            uint8_t data[MAX_MESSAGE];
+        };
+
+        struct Ring
+        {
+            alignas(64) std::atomic<uint32_t> head;  // 生产者写入，消费者在其上 futex 等待
+            alignas(64) std::atomic<uint32_t> tail;  // 消费者写入
+            std::atomic<uint32_t> waiting;           // 消费者正在等待
+            std::atomic<int32_t> consumer_pid;       // 消费者进程号，0 表示未连接
+            Slot slots[SLOTS];
+        };
+
+        struct Segment
+        {
+            std::atomic<uint32_t> magic;
+            Ring to_robot;
+            Ring to_vision;
+        };
+
+        Shm_link() = default;
+        Shm_link(const Shm_link &) = delete;
+        Shm_link &operator=(const Shm_link &) = delete;
+        ~Shm_link() {
+            close();
+        }
+
+        /**
+         * 打开共享内存段，name 为 /dev/shm 下的名字（以 / 开头）
+         * ROBOT 端不存在时创建；已存在时沿用，使重启后已连接的视觉程序仍然有效
+         */
+        bool open(const std::string &name, Role role) {
+            int fd = role == Role::ROBOT ? shm_open(name.c_str(), O_RDWR | O_CREAT, 0666)
+                                         : shm_open(name.c_str(), O_RDWR, 0);
+            if (fd < 0) {
+                return false;
+            }
+            if (role == Role::ROBOT && ftruncate(fd, sizeof(Segment)) < 0) {
+                ::close(fd);
+                return false;
+            }
+            void *p = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) {
+                return false;
+            }
+            segment = static_cast<Segment *>(p);
+            if (role == Role::ROBOT) {
+                if (segment->magic.load(std::memory_order_acquire) != MAGIC) {
+                    memset(static_cast<void *>(segment), 0, sizeof(Segment));
+                    segment->magic.store(MAGIC, std::memory_order_release);
+                }
+                rx = &segment->to_robot;
+                tx = &segment->to_vision;
+            } else {
+                if (segment->magic.load(std::memory_order_acquire) != MAGIC) {
+                    close();
+                    return false;
+                }
+                rx = &segment->to_vision;
+                tx = &segment->to_robot;
+            }
+            // 丢弃上一个消费者遗留的旧消息
+            rx->tail.store(rx->head.load(std::memory_order_acquire), std::memory_order_release);
+            rx->consumer_pid.store(getpid(), std::memory_order_release);
+            return true;
+        }
+
+        void close() {
+            if (segment == nullptr) {
+                return;
+            }
+            rx->consumer_pid.store(0, std::memory_order_release);
+            munmap(segment, sizeof(Segment));
+            segment = nullptr;
+            rx = tx = nullptr;
+        }
+
+        bool is_open() const {
+            return segment != nullptr;
+        }
+
+        /**
+         * 对方是否已连接并仍在运行，进程存活检查每秒最多做一次
+         */
+        bool peer_alive() {
+            if (segment == nullptr) {
+                return false;
+            }
+            int32_t pid = tx->consumer_pid.load(std::memory_order_acquire);
+            if (pid == 0) {
+                return false;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (pid != checked_pid || now - checked_at > std::chrono::seconds(1)) {
+                checked_pid = pid;
+                checked_at = now;
+                checked_alive = kill(pid, 0) == 0 || errno == EPERM;
+            }
+            return checked_alive;
+        }
+
+        /**
+         * 写入一条消息，队列已满或消息过长时返回 false，消息被丢弃
+         */
+        bool send(const void *data, size_t len) {
+            if (segment == nullptr || len > MAX_MESSAGE) {
+                return false;
+            }
+            uint32_t head = tx->head.load(std::memory_order_relaxed);
+            if (head - tx->tail.load(std::memory_order_acquire) >= SLOTS) {
+                return false;
+            }
+            Slot &slot = tx->slots[head % SLOTS];
+            slot.len = static_cast<uint32_t>(len);
+            memcpy(slot.data, data, len);
+            // 与消费者对 waiting 的先写后读配对，保证不会漏掉唤醒
+            tx->head.store(head + 1, std::memory_order_seq_cst);
+            if (tx->waiting.load(std::memory_order_seq_cst)) {
+                futex(&tx->head, FUTEX_WAKE, 1, nullptr);
+            }
+            return true;
+        }
+
+        /**
+         * 取出一条消息，队列为空时最多等待 timeout_ms 毫秒，超时返回 0
+         * 长度超过 cap 的部分被截断
+         */
+        size_t receive(void *out, size_t cap, int timeout_ms) {
+            if (segment == nullptr) {
+                return 0;
+            }
+            uint32_t tail = rx->tail.load(std::memory_order_relaxed);
+            uint32_t head = rx->head.load(std::memory_order_acquire);
+            if (head == tail) {
+                rx->waiting.store(1, std::memory_order_seq_cst);
+                head = rx->head.load(std::memory_order_seq_cst);
+                if (head == tail) {
+                    timespec timeout{ .tv_sec = timeout_ms / 1000, .tv_nsec = timeout_ms % 1000 * 1000000L };
+                    futex(&rx->head, FUTEX_WAIT, tail, &timeout);
+                    head = rx->head.load(std::memory_order_acquire);
+                }
+                rx->waiting.store(0, std::memory_order_relaxed);
+                if (head == tail) {
+                    return 0;
+                }
+            }
+            const Slot &slot = rx->slots[tail % SLOTS];
+            size_t len = std::min<size_t>(slot.len, cap);
+            memcpy(out, slot.data, len);
+            rx->tail.store(tail + 1, std::memory_order_release);
+            return len;
+        }
+
+       private:
+        static long futex(std::atomic<uint32_t> *addr, int op, uint32_t val, const timespec *timeout) {
+            // 段在进程之间共享，不能使用 FUTEX_PRIVATE_FLAG
+            return syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), op, val, timeout, nullptr, 0);
+        }
+
+        Segment *segment = nullptr;
+        Ring *rx = nullptr;
+        Ring *tx = nullptr;
+
+        int32_t checked_pid = 0;
+        bool checked_alive = false;
+        std::chrono::steady_clock::time_point checked_at;
+    };
+}  // namespace IO
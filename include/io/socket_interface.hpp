@@ -5,49 +5,116 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <array>
+#include <atomic>
 #include <cstdio>
 #include <cstring>
 #include <map>
+#include <mutex>
 
+#include "clock_sync.hpp"
 #include "io_callback.hpp"
+#include "latency_histogram.hpp"
 #include "robot.hpp"
+#include "shm_link.hpp"
 #include "utils.hpp"
 
 namespace IO
 {
-    class Server_socket_interface : public Callback<Robot::ReceiveNavigationInfo>, public Callback_key<uint8_t, Robot::Auto_aim_control>
+    struct Socket_stats
+    {
+        std::atomic<uint64_t> rx_packets{ 0 };   // UDP 收包
+        std::atomic<uint64_t> rx_wakeups{ 0 };   // 收到数据的 recvmmsg 调用次数，rx_packets / rx_wakeups 即每次唤醒处理的包数
+        std::atomic<uint64_t> rx_invalid{ 0 };   // 被截断或长度与 header 对应的包类型不符而丢弃的包
+        std::atomic<uint64_t> rx_overflow{ 0 };  // 内核因接收缓冲区已满而丢弃的包（SO_RXQ_OVFL）
+        std::atomic<uint64_t> tx_packets{ 0 };   // UDP 发包
+        std::atomic<uint64_t> tx_errors{ 0 };    // sendto 失败或 header 没有对应的 client
+        std::atomic<uint64_t> shm_rx{ 0 };       // 共享内存收包
+        std::atomic<uint64_t> shm_tx{ 0 };       // 共享内存发包
+        std::atomic<uint64_t> shm_dropped{ 0 };  // 对端读得太慢，发送队列已满而丢弃的包
+    };
+
+    class Server_socket_interface : public Callback<Robot::ReceiveNavigationInfo>,
+                                    public Callback_key<uint8_t, Robot::Auto_aim_control>,
+                                    public Callback_key<uint8_t, Robot::ReceiveGimbalPacket>,
+                                    public Callback_key<uint8_t, Robot::Attitude_query>
 
     {
+        using Aim_callback = Callback_key<uint8_t, Robot::Auto_aim_control>;
+        using Tracker_callback = Callback_key<uint8_t, Robot::ReceiveGimbalPacket>;
+        using Attitude_callback = Callback_key<uint8_t, Robot::Attitude_query>;
+
        public:
+        // 以某个 header 注册了跟踪器状态回调时，该 header 的包按 ReceiveGimbalPacket 解析，否则按 Auto_aim_control
+        using Aim_callback::register_callback_key;
+        using Tracker_callback::register_callback_key;
+        // 姿态查询按查询包中的 client 分发，回调中用 send_to(query.client, ...) 回复
+        using Attitude_callback::register_callback_key;
+
         Server_socket_interface(std::string name);
         ~Server_socket_interface();
         void task();
         void add_client(uint8_t header, std::string ip, int port);
 
+        // reactor 模式下使用：非阻塞地处理所有已到达的数据包
+        bool on_readable();
+        int fd() const {
+            return sockfd;
+        }
+
+        // 回放一个记录下来的数据包，走与接收时相同的回调分发
+        void replay(const uint8_t *data, size_t len);
+
+        // 可在多个线程中调用
         template<typename T>
         void send(const T &pkg) {
-            uint8_t header = *(uint8_t *)(&pkg);
-            // LOG_INFO("header %d client: %d\n", header, clients.find(header)->second.sin_addr.s_addr);
-            auto n = sendto(
-                sockfd,
-                (const char *)(&pkg),
-                sizeof(pkg),
-                MSG_CONFIRM,
-                (const struct sockaddr *)&clients.find(header)->second,
-                sizeof(clients.find(header)->second));
-            if(n == -1) {
-                LOG_ERR("error socket send");
-            }  
+            send_to(*(const uint8_t *)(&pkg), &pkg, sizeof(pkg));
         }
 
+        // 按 client 的 header 查找地址发送，header 不必是数据的第一个字节
+        void send_to(uint8_t client, const void *data, size_t len);
+
+        // 与 client 之间的时钟同步状态，没有通过 add_client 登记的 client 返回空
+        const Clock_sync *clock(uint8_t client) const {
+            return clock_syncs[client].load(std::memory_order_acquire);
+        }
+
+        Socket_stats stats;
+        // 视觉曝光到该帧设定值第一次用于电机控制的延迟，由使用方记录
+        UserLib::Latency_histogram aim_latency;
+
+        constexpr static size_t PACKET_SIZE = 256;
+        constexpr static size_t RX_BATCH = 16;
+
+       private:
+        // 一次 recvmmsg 最多取 RX_BATCH 个包，返回取到的包数，出错时返回 -1
+        int receive_batch(int flags);
+        // 校验长度后按 header 解包并分发；cli_addr 为空时（共享内存、回放）不登记 client；可在多个线程中调用，分发串行执行
+        void handle_packet(const uint8_t *data, size_t len, const sockaddr_in *cli_addr);
+        void shm_task();
+        void clock_sync_task();
+
        private:
         int64_t port_num;
         int sockfd;
 
         sockaddr_in serv_addr;
         std::map<uint8_t, sockaddr_in> clients;
+        std::array<bool, 256> local_clients{};  // header 对应的 client 是否为 127.x
+        Shm_link shm;
+        std::mutex tx_lock;
+        std::mutex rx_lock;  // 串行化 handle_packet，保证同一时刻只有一个线程执行接收回调
+        std::array<std::atomic<Clock_sync *>, 256> clock_syncs{};
+
+        // recvmmsg 使用的预分配接收数组，只在接收线程中访问
+        uint8_t rx_buffers[RX_BATCH][PACKET_SIZE];
+        sockaddr_in rx_addrs[RX_BATCH];
+        iovec rx_iovs[RX_BATCH];
+        mmsghdr rx_msgs[RX_BATCH];
+        alignas(cmsghdr) uint8_t rx_controls[RX_BATCH][CMSG_SPACE(sizeof(uint32_t))];
+        uint32_t last_overflow = 0;
 
-        char buffer[256];
+        int record_source = -1;
 
        public:
         std::string name;
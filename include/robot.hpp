@@ -1,5 +1,6 @@
 #ifndef __ROBOT__
 #define __ROBOT__
+#include "bullet_speed.hpp"
 #include "types.hpp"
 
 namespace Robot
@@ -63,6 +64,7 @@ namespace Robot
 
         Types::ReceivePacket_Super_Cap super_cap_info;
         Types::Referee_info referee_info;
+        Shoot::Bullet_speed_estimator bullet_speed;  // 裁判系统实测弹速
 
         void set_mode(Types::ROBOT_MODE set_mode) {
             this->last_mode = this->mode;
@@ -113,6 +115,8 @@ namespace Robot
         float r1;
         float r2;
         float dz;
+        // 跟踪器状态对应的图像曝光时间，视觉端 steady_clock 纳秒
+        int64_t capture_ns;
         /*  决策部分   */
 
     } __attribute__((packed));
@@ -141,6 +145,8 @@ namespace Robot
         bool fire;
 
         Types::ROBOT_MODE mode = Types::ROBOT_MODE::ROBOT_NO_FORCE;
+        // 计算该设定值所用图像的曝光时间，steady_clock 纳秒；为 0（旧版视觉不发送此字段）时不做延迟补偿
+        int64_t capture_ns = 0;
     } __attribute__((packed));
 
     struct SendAutoAimInfo
@@ -149,6 +155,31 @@ namespace Robot
         float yaw;
         float pitch;
         bool red;
+        // yaw / pitch 对应的 IMU 采样时间，steady_clock 纳秒，视觉可据此插值出曝光时刻的姿态
+        int64_t stamp_ns;
+    } __attribute__((packed));
+
+    // 视觉按图像曝光时间查询云台姿态，控制程序从 IMU 姿态历史（约 0.5s）中插值后回复
+    constexpr uint8_t ATTITUDE_QUERY_HEADER = 0x7E;
+    constexpr uint8_t ATTITUDE_REPLY_HEADER = 0x7F;
+
+    struct Attitude_query
+    {
+        uint8_t header = ATTITUDE_QUERY_HEADER;
+        uint8_t client;    // 查询方的 header，回复发往该 client 登记的地址
+        uint16_t seq;      // 原样返回，用于匹配回复
+        int64_t stamp_ns;  // 曝光时间，视觉端 steady_clock 纳秒；与该 client 有时钟同步时换算到本地时钟
+    } __attribute__((packed));
+
+    struct Attitude_reply
+    {
+        uint8_t header = ATTITUDE_REPLY_HEADER;
+        uint8_t client;
+        uint16_t seq;
+        bool valid;  // 查询时间早于保存的姿态范围或没有姿态数据时为 false
+        float yaw;
+        float pitch;
+        float roll;
     } __attribute__((packed));
 
     struct SendVisionControl
@@ -37,6 +37,8 @@
 
 #pragma once
 
+#include <cmath>
+
 #include "types.hpp"
 
 namespace Control
@@ -47,13 +49,54 @@ namespace Control
            resistance_coff_qd_30, g;
    };
 
+   /**
+    * solveArmors 的结果，按结构体数组（SoA）存放，下标 i 对应角度为 yaw + i * 2pi / armors_num 的装甲板
+    * 角度与 getYaw / getPitch 同号
+    */
+   struct ArmorSolutions
+   {
+       constexpr static int MAX_ARMORS = 4;
+
+       int count;          // 装甲板数量
+       bool track_target;  // 目标转速低于可跟踪转速，逐块跟踪装甲板；否则应瞄准中心等待（使用 solve）
+       bool valid[MAX_ARMORS];
+       float fly_time[MAX_ARMORS];
+       float yaw[MAX_ARMORS];
+       float pitch[MAX_ARMORS];
+       float d_yaw[MAX_ARMORS];    // 相对当前云台角度需要转过的角度
+       float d_pitch[MAX_ARMORS];
+       float x[MAX_ARMORS];        // 子弹到达时装甲板的位置
+       float y[MAX_ARMORS];
+       float z[MAX_ARMORS];
+       float facing[MAX_ARMORS];   // 子弹到达时装甲板法向与视线夹角的余弦，越接近 1 越正对
+   };
+
    class BulletSolver
    {
       public:
        explicit BulletSolver();
 
+       /**
+        * 解算击中目标所需的 yaw / pitch，收敛返回 true；目标超出射程或不收敛返回 false
+        * 迭代以上一次成功解算的飞行时间与抬枪量作为初值，连续调用（每个控制周期）时通常 1~2 次迭代即可收敛
+        */
        bool solve(Vec3d pos, Vec3d vel, double bullet_speed, double yaw, double v_yaw,
                   double r1, double r2, double dz, int armors_num);
+       /**
+        * 同时解算目标所有装甲板（至多 4 块），返回收敛的装甲板数量
+        * 各装甲板同步迭代，每次迭代对所有装甲板执行同样的无分支计算，耗时与 solve 解算一块相当
+        * gimbal_yaw / gimbal_pitch 为当前云台角度，用于计算切换到各装甲板的代价
+        */
+       int solveArmors(Vec3d pos, Vec3d vel, double bullet_speed, double yaw, double v_yaw, double r1, double r2,
+                       double dz, int armors_num, double gimbal_yaw, double gimbal_pitch, ArmorSolutions &out);
+       /**
+        * 在正对程度足够的装甲板中选择云台转动量最小的一块，没有可选装甲板或目标转速过高时返回 -1
+        */
+       int selectArmor(const ArmorSolutions &armors) const;
+       // 目标转速低于可跟踪转速时才逐块跟踪装甲板，否则只能瞄准中心（solve）
+       bool tracksTarget(double v_yaw) const {
+           return std::abs(v_yaw) < max_track_target_vel_;
+       }
        double getResistanceCoefficient(double bullet_speed) const;
        double getYaw() const {
            return output_yaw_;
@@ -65,6 +108,8 @@ namespace Control
        Vec3d target_pos_{};
 
       private:
+       void setBulletSpeed(double bullet_speed);
+
        BulletSolverConfig config_{};
        double max_track_target_vel_;
        double output_yaw_{}, output_pitch_{};
@@ -73,5 +118,12 @@ namespace Control
        bool track_target_;
 
        double fly_time_;
+       double pitch_offset_{};  // 收敛时瞄准高度与目标高度之差，即抬枪量
+       bool warm_{ false };      // 上一次解算成功，可作为本次迭代的初值
+
+       // solveArmors 各装甲板上一次收敛的结果，作为下一次的初值
+       float armor_fly_time_[ArmorSolutions::MAX_ARMORS]{};
+       float armor_pitch_offset_[ArmorSolutions::MAX_ARMORS]{};
+       int armors_warm_{ 0 };    // 上一次解算的装甲板数量，0 表示没有可用的初值
    };
 }  // namespace rm_gimbal_controllers
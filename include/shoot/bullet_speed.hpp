@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+#include "seqlock.hpp"
+#include "types.hpp"
+
+namespace Shoot
+{
+    /**
+     * 由裁判系统 SHOOT_DATA（0x0207）报告的实测初速在线估计弹速
+     * 每个发射机构（shooter_id）的摩擦轮单独估计，用指数加权的均值与方差跟踪；
+     * 偏离均值过大的样本（摩擦轮掉速、卡弹后的低速弹）不参与更新，连续多发偏离则认为摩擦轮转速设定改变，重新估计
+     * 样本由裁判系统线程写入，估计值通过 Seqlock 发布，可在任意线程无锁读取
+     */
+    class Bullet_speed_estimator
+    {
+       public:
+        constexpr static int SHOOTERS = 4;  // shooter_id 为 1~3
+
+        struct Estimate
+        {
+            uint32_t samples;  // 参与估计的样本数，0 表示还没有数据
+            fp32 speed;        // m/s
+            fp32 stddev;       // 单发初速的标准差
+        };
+
+        void add_sample(uint8_t shooter_id, fp32 speed);
+
+        Estimate estimate(uint8_t shooter_id) const {
+            return shooter_id < SHOOTERS ? published[shooter_id].load() : Estimate{};
+        }
+
+        // 有实测数据时返回估计值，否则返回 fallback
+        fp32 speed(uint8_t shooter_id, fp32 fallback) const {
+            Estimate e = estimate(shooter_id);
+            return e.samples > 0 ? e.speed : fallback;
+        }
+
+       private:
+        struct State
+        {
+            Estimate estimate;
+            uint32_t rejected;  // 连续被判为异常的样本数
+        };
+
+        State states[SHOOTERS]{};
+        UserLib::Seqlock<Estimate> published[SHOOTERS];
+    };
+}  // namespace Shoot
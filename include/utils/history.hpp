@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "seqlock.hpp"
+
+namespace UserLib
+{
+    /**
+     * 单写多读的定长历史记录，按时间戳查询
+     * 每个位置是一个 Seqlock，写端 wait-free；读端只会读到完整的样本，写端追上读端时该样本被跳过
+     * @tparam T 样本类型，必须可平凡复制
+     * @tparam N 保存的样本数，必须是 2 的幂
+     */
+    template<typename T, size_t N>
+    class History
+    {
+        static_assert((N & (N - 1)) == 0, "History size must be a power of two");
+
+       public:
+        struct Entry
+        {
+            int64_t stamp_ns;
+            T value;
+        };
+
+        // 只允许一个线程调用，stamp_ns 需单调递增
+        void push(int64_t stamp_ns, const T &value) {
+            uint64_t index = count.load(std::memory_order_relaxed);
+            entries[index & (N - 1)].store(Entry{ stamp_ns, value });
+            count.store(index + 1, std::memory_order_release);
+        }
+
+        bool latest(Entry &entry) const {
+            uint64_t end = count.load(std::memory_order_acquire);
+            if (end == 0) {
+                return false;
+            }
+            entry = entries[(end - 1) & (N - 1)].load();
+            return true;
+        }
+
+        /**
+         * 找到时间上包围 stamp_ns 的两个样本，before.stamp_ns <= stamp_ns <= after.stamp_ns
+         * stamp_ns 晚于最新样本时两者都取最新样本；早于保存的最旧样本或没有样本时返回 false
+         */
+        bool find(int64_t stamp_ns, Entry &before, Entry &after) const {
+            uint64_t end = count.load(std::memory_order_acquire);
+            if (end == 0) {
+                return false;
+            }
+            uint64_t begin = end > N ? end - N : 0;
+            after = entries[(end - 1) & (N - 1)].load();
+            if (after.stamp_ns <= stamp_ns) {
+                before = after;
+                return true;
+            }
+            // 从新到旧查找，最后的几个位置可能正在被写端覆盖，时间戳不递减即说明已被覆盖
+            for (uint64_t i = end - 1; i > begin; i--) {
+                Entry entry = entries[(i - 1) & (N - 1)].load();
+                if (entry.stamp_ns > after.stamp_ns) {
+                    return false;
+                }
+                if (entry.stamp_ns <= stamp_ns) {
+                    before = entry;
+                    return true;
+                }
+                after = entry;
+            }
+            return false;
+        }
+
+       private:
+        Seqlock<Entry> entries[N];
+        std::atomic<uint64_t> count{ 0 };
+    };
+}  // namespace UserLib
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace UserLib
+{
+    /**
+     * 定宽分桶的延迟直方图，记录端可在任意线程无锁调用
+     * 读端取累计计数的快照，两次快照相减即为这段时间内的分布
+     */
+    template<int64_t BUCKET_WIDTH_NS>
+    class Histogram
+    {
+       public:
+        constexpr static size_t BUCKETS = 128;
+        constexpr static int64_t BUCKET_NS = BUCKET_WIDTH_NS;  // 最后一桶包含所有 >= 127 * BUCKET_NS 的样本
+
+        using Snapshot = std::array<uint64_t, BUCKETS>;
+
+        void record(int64_t ns) {
+            size_t bucket = ns <= 0 ? 0 : static_cast<size_t>(ns / BUCKET_NS);
+            buckets[bucket < BUCKETS ? bucket : BUCKETS - 1].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Snapshot snapshot() const {
+            Snapshot s;
+            for (size_t i = 0; i < BUCKETS; i++) {
+                s[i] = buckets[i].load(std::memory_order_relaxed);
+            }
+            return s;
+        }
+
+        /**
+         * 分位数所在桶的上沿（纳秒），没有样本时返回 0
+         */
+        static int64_t percentile(const Snapshot &s, double p) {
+            uint64_t total = 0;
+            for (auto c : s) {
+                total += c;
+            }
+            if (total == 0) {
+                return 0;
+            }
+            uint64_t rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BUCKETS; i++) {
+                seen += s[i];
+                if (seen >= rank) {
+                    return static_cast<int64_t>(i + 1) * BUCKET_NS;
+                }
+            }
+            return BUCKETS * BUCKET_NS;
+        }
+
+       private:
+        std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+    };
+
+    using Latency_histogram = Histogram<500000>;  // 每桶 0.5ms，上限 63.5ms，用于端到端延迟
+    using Jitter_histogram = Histogram<10000>;    // 每桶 10us，上限 1.27ms，用于周期任务的唤醒抖动
+}  // namespace UserLib
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace UserLib
+{
+    /**
+     * 单写多读的顺序锁
+     * 写端 wait-free，不会被读端阻塞；读端与写端冲突时重试，保证读到的是同一次 store 的完整数据
+     * 数据按 8 字节分块存放在 relaxed 原子变量中，因此即使读到一半被改写也不存在数据竞争，
+     * 是否撕裂只由前后两次读到的序号判断
+     */
+    template<typename T>
+    class Seqlock
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Seqlock requires a trivially copyable type");
+        constexpr static size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+       public:
+        Seqlock() {
+            store(T{});
+        }
+
+        explicit Seqlock(const T &value) {
+            store(value);
+        }
+
+        // 只允许一个线程调用
+        void store(const T &value) {
+            uint64_t buf[WORDS]{};
+            std::memcpy(buf, &value, sizeof(T));
+            uint64_t s = seq.load(std::memory_order_relaxed);
+            seq.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORDS; i++) {
+                data[i].store(buf[i], std::memory_order_relaxed);
+            }
+            seq.store(s + 2, std::memory_order_release);
+        }
+
+        T load() const {
+            uint64_t buf[WORDS];
+            uint64_t begin, end;
+            do {
+                begin = seq.load(std::memory_order_acquire);
+                for (size_t i = 0; i < WORDS; i++) {
+                    buf[i] = data[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                end = seq.load(std::memory_order_relaxed);
+            } while ((begin & 1) || begin != end);
+            T value;
+            std::memcpy(&value, buf, sizeof(T));
+            return value;
+        }
+
+        // 已完成的 store 次数
+        uint64_t version() const {
+            return seq.load(std::memory_order_acquire) >> 1;
+        }
+
+       private:
+        std::atomic<uint64_t> seq{ 0 };
+        std::atomic<uint64_t> data[WORDS]{};
+    };
+}  // namespace UserLib
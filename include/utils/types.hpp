@@ -73,6 +73,7 @@ namespace Types
         Referee::GameRobotStatus game_robot_status_data;
         Referee::BulletAllowance bullet_allowance_data;
         Referee::PowerHeatData power_heat_data;
+        Referee::ShootData shoot_data;
     };
 
     typedef struct
@@ -48,6 +48,9 @@ namespace Chassis
     [[noreturn]] void Chassis::task() {
         std::jthread power_daemon(&Power::Manager::powerDaemon, &power_manager);
         while (true) {
+            for (auto &motor : motors) {
+                motor.update();
+            }
             decomposition_speed();
             //LOG_INFO("chassis.wheel_speed: %f, %f, %f, %f\n", wheel_speed[0], wheel_speed[1], wheel_speed[2], wheel_speed[3]);
             if (robot_set->mode == Types::ROBOT_MODE::ROBOT_NO_FORCE) {
@@ -103,6 +106,7 @@ namespace Chassis
                     // LOG_INFO("i:%d, pid:%f, cmd:%f\n", i, wheels_pid[i].out, cmd_power[i]);
                 }
             }
+            Hardware::DJIMotorManager::commit(motors);
             UserLib::sleep_ms(config.ControlTime);
         }
     }
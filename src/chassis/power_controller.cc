@@ -244,13 +244,13 @@ std::array<float, 4> Manager::getControlledOutput(PowerObj *objs[4]) {
             samples[0][0] = 0;
             samples[1][0] = 0;
             for (int i = 0; i < 4; i++) {
-                //LOG_INFO("%d", motors[i].motor_measure_.given_current);
+                // 与底盘控制线程并行，直接读取一致的反馈快照
+                auto measure = motors[i].snapshot().message;
+                //LOG_INFO("%d", measure.given_current);
 
-                effectivePower += motors[i].motor_measure_.given_current * k0 *
-                                  rpm2av(motors[i].motor_measure_.speed_rpm);
-                samples[0][0] += fabsf(rpm2av(motors[i].motor_measure_.speed_rpm));
-                samples[1][0] += motors[i].motor_measure_.given_current * k0 *
-                                 motors[i].motor_measure_.given_current * k0;
+                effectivePower += measure.given_current * k0 * rpm2av(measure.speed_rpm);
+                samples[0][0] += fabsf(rpm2av(measure.speed_rpm));
+                samples[1][0] += measure.given_current * k0 * measure.given_current * k0;
             }
             estimatedPower = k1 * samples[0][0] + k2 * samples[1][0] + effectivePower + k3;
 
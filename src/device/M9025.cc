@@ -26,14 +26,16 @@ namespace Device
         temperate = frame.data[1];
     }
 
-    void M9025::unpack(const can_frame& frame) {
+    void M9025::unpack(const can_frame& frame, const IO::Rx_time& stamp) {
         motor_measure.unpack(frame);
-        update_time();
+        update_time(stamp);
     }
 
     void M9025::enable() {
         IO::io<CAN>[can_name] -> register_callback_key(
-                                  0x140 + id, [&](const can_frame& frame) { unpack(frame); });
+                                  0x140 + id, [&](const can_frame& frame, const IO::Rx_time& stamp) {
+                                      unpack(frame, stamp);
+                                  });
     }
 
 }  // namespace Device
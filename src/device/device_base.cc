@@ -5,19 +5,31 @@ using namespace std::chrono;
 
 namespace Device
 {
-    DeviceBase::DeviceBase() : last_time(system_clock::now() - 10s), offline_time(Config::DEFAULT_OFFLINE_TIME) {
+    DeviceBase::DeviceBase() : last_time(steady_clock::now() - 10s), offline_time(Config::DEFAULT_OFFLINE_TIME) {
     }
 
     DeviceBase::DeviceBase(uint32_t offline_time_t)
-        : last_time(system_clock::now() - 10s),
+        : last_time(steady_clock::now() - 10s),
           offline_time(offline_time_t) {
     }
 
     bool DeviceBase::offline() const {
-        return duration_cast<milliseconds>(system_clock::now() - last_time).count() >= offline_time;
+        return duration_cast<milliseconds>(steady_clock::now() - last_time).count() >= offline_time;
+    }
+
+    DeviceBase::time_point DeviceBase::last_update() const {
+        return last_time;
+    }
+
+    nanoseconds DeviceBase::sample_age() const {
+        return steady_clock::now() - last_time;
     }
 
     void DeviceBase::update_time() {
-        last_time = system_clock::now();
+        last_time = steady_clock::now();
+    }
+
+    void DeviceBase::update_time(time_point stamp) {
+        last_time = stamp;
     }
 }  // namespace Device
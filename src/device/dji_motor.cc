@@ -1,8 +1,19 @@
 #include "dji_motor.hpp"
 
 #include "io.hpp"
+#include "logger.hpp"
+#include "macro_helpers.hpp"
 #include "utils.hpp"
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <ctime>
 #include <mutex>
 #include <chrono>
 
@@ -49,6 +60,7 @@ namespace Hardware {
                 motor_id_ = 0;
             }
         }
+        feedback.store({ .message = motor_measure_, .data = data_, .stamp = {} });
     }
 
     void DJIMotor::Message::unpack(const can_frame &frame) {
@@ -58,18 +70,30 @@ namespace Hardware {
         temperate = frame.data[6];
     }
 
-    void DJIMotor::unpack(const can_frame &frame) {
-        motor_measure_.unpack(frame);
-        data_.rotor_angle = ECD_8192_TO_RAD * static_cast<float>(motor_measure_.ecd);
-        data_.rotor_angular_velocity = RPM_TO_RAD_S * static_cast<float>(motor_measure_.speed_rpm);
-        data_.rotor_linear_velocity = data_.rotor_angular_velocity * data_.radius;
+    void DJIMotor::unpack(const can_frame &frame, const IO::Rx_time &stamp) {
+        // 唯一的写者读取自己上次发布的数据不会重试，接收路径保持 wait-free
+        Sample sample = feedback.load();
+        auto &[message, data, sample_stamp] = sample;
+        message.unpack(frame);
+        data.rotor_angle = ECD_8192_TO_RAD * static_cast<float>(message.ecd);
+        data.rotor_angular_velocity = RPM_TO_RAD_S * static_cast<float>(message.speed_rpm);
+        data.rotor_linear_velocity = data.rotor_angular_velocity * data.radius;
+
+        data.output_angular_velocity = data.rotor_angular_velocity * data.reduction_ratio;
+        data.output_linear_velocity = data.rotor_linear_velocity * data.reduction_ratio;
+        sample_stamp = stamp;
+        feedback.store(sample);
+        update_time(stamp);
+    }
 
-        data_.output_angular_velocity = data_.rotor_angular_velocity * data_.reduction_ratio;
-        data_.output_linear_velocity = data_.rotor_linear_velocity * data_.reduction_ratio;
-        update_time();
+    void DJIMotor::update() {
+        auto [message, data, stamp] = feedback.load();
+        motor_measure_ = message;
+        data_ = data;
     }
 
     void DJIMotor::set(float x) {
+        rx_to_control = sample_age();
         x = x >> controller;
         give_current = static_cast<int16_t>(x);
     }
@@ -84,10 +108,56 @@ namespace Hardware {
 
     namespace DJIMotorManager {
 
-        std::unordered_map<std::string, CanBlock> motors_map;
+        // 总线在注册时依次追加，之后不会移动，发送线程按下标遍历
+        std::array<CanBlock, MAX_CAN_BUSES> buses;
+        size_t bus_count = 0;
         std::thread task_handle;
         std::mutex data_lock;
 
+        bool tx_on_commit = false;
+        int64_t coalesce_ns = 0;
+        // 第 i 位表示第 i 条总线有 commit 尚未发送，发送线程在其上 futex 等待
+        std::atomic<uint32_t> dirty_buses{ 0 };
+
+        // 调用者需持有 data_lock
+        static CanBlock *find_bus(const std::string &can_name) {
+            for (size_t i = 0; i < bus_count; i++) {
+                if (buses[i].can_name_ == can_name) {
+                    return &buses[i];
+                }
+            }
+            if (bus_count == MAX_CAN_BUSES) {
+                LOG_ERR("Motor error[%s]: too many can buses\n", can_name.c_str());
+                return nullptr;
+            }
+            buses[bus_count].can_name_ = can_name;
+            return &buses[bus_count++];
+        }
+
+        // 按总线上已注册的电机重新生成发送计划，帧按 can_id 排序，没有电机的帧不发送
+        static void compile_plan(CanBlock &bus) {
+            constexpr canid_t FRAME_IDS[FRAMES_PER_BUS] = { 0x1ff, 0x200, 0x2ff };
+            int slot[FRAMES_PER_BUS] = { -1, -1, -1 };
+            bus.frame_count_ = 0;
+            for (size_t i = 0; i < FRAMES_PER_BUS; i++) {
+                for (const auto motor : bus.motors_) {
+                    if (static_cast<size_t>(motor->can_info.can_id_) == i) {
+                        slot[i] = static_cast<int>(bus.frame_count_);
+                        bus.frames_[bus.frame_count_++] = { .can_id = FRAME_IDS[i], .len = 8 };
+                        break;
+                    }
+                }
+            }
+            bus.entry_count_ = 0;
+            for (const auto motor : bus.motors_) {
+                bus.entries_[bus.entry_count_++] = {
+                    .frame = static_cast<uint8_t>(slot[static_cast<int>(motor->can_info.can_id_)]),
+                    .offset = static_cast<uint8_t>(motor->can_info.data_bias),
+                    .current = &motor->give_current,
+                };
+            }
+        }
+
         bool can_conflict(const DJIMotor &motor1, const DJIMotor &motor2) {
             return (motor1.can_info.can_id_ == motor2.can_info.can_id_ &&
                     motor1.can_info.data_bias == motor2.can_info.data_bias) ||
@@ -104,9 +174,12 @@ namespace Hardware {
                 LOG_ERR("Motor error[%s]: can device is invalid\n", motor.motor_name_.c_str());
                 return;
             }
-            auto &[can_, motors_] = motors_map[motor.can_info.can_name_];
-            can_ = can_interface;
-            for (const auto &other_motor: motors_) {
+            auto block = find_bus(motor.can_info.can_name_);
+            if (block == nullptr) {
+                return;
+            }
+            block->can_ = can_interface;
+            for (const auto &other_motor: block->motors_) {
                 if (can_conflict(*other_motor, motor)) {
                     LOG_ERR("Motor error[%s, %s]: A can conflict occurred when registering motor\n",
                             other_motor->motor_name_.c_str(), motor.motor_name_.c_str());
@@ -114,47 +187,184 @@ namespace Hardware {
                 }
             }
             motor.motor_enabled_ = true;
-            motors_.push_back(&motor);
-            can_->register_callback_key(motor.can_info.callback_flag, [&](const can_frame &frame) {
-                motor.unpack(frame);
-            });
+            motor.can_info.bus_index = static_cast<int>(block - buses.data());
+            block->motors_.push_back(&motor);
+            compile_plan(*block);
+            block->can_->register_callback_key(
+                motor.can_info.callback_flag,
+                [&](const can_frame &frame, const IO::Rx_time &stamp) { motor.unpack(frame, stamp); });
+        }
+
+        void set_tx_period(const std::string &can_name, std::chrono::nanoseconds period) {
+            std::unique_lock lock(data_lock);
+            if (period.count() <= 0) {
+                LOG_ERR("Motor error[%s]: invalid tx period\n", can_name.c_str());
+                return;
+            }
+            if (auto block = find_bus(can_name)) {
+                block->period_ = period;
+            }
+        }
+
+        void set_tx_on_commit(bool enable, std::chrono::nanoseconds coalesce) {
+            std::unique_lock lock(data_lock);
+            tx_on_commit = enable;
+            coalesce_ns = std::max<int64_t>(0, coalesce.count());
+        }
+
+        static int64_t monotonic_ns() {
+            timespec ts{};
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000000ll + ts.tv_nsec;
+        }
+
+        void commit_buses(uint32_t mask) {
+            if (mask == 0) {
+                return;
+            }
+            int64_t now = monotonic_ns();
+            for (uint32_t bits = mask; bits != 0; bits &= bits - 1) {
+                int64_t expected = 0;
+                buses[std::countr_zero(bits)].committed_ns_.compare_exchange_strong(
+                    expected, now, std::memory_order_relaxed);
+            }
+            if (!tx_on_commit) {
+                return;
+            }
+            // 只有置位了新的总线时才需要唤醒，已经置位说明发送线程已被唤醒、正在合并
+            uint32_t prev = dirty_buses.fetch_or(mask, std::memory_order_release);
+            if ((prev & mask) != mask) {
+                syscall(SYS_futex, reinterpret_cast<uint32_t *>(&dirty_buses), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+            }
+        }
+
+        // 每 REPORT_TICKS 次唤醒上报一次发送线程每次唤醒的 CPU 时间、各总线的发送抖动与各电机 RX 到控制的延迟，
+        // 总线统计见 IO::report_task
+        constexpr int REPORT_TICKS = 1000;
+
+        static uint64_t thread_cpu_ns() {
+            timespec ts{};
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+        }
+
+#ifdef __DEBUG__
+        static void report(int ticks, uint64_t cpu_ns) {
+            logger.push_value("dji_motor.tx_cpu_us_per_tick", (double)cpu_ns / ticks / 1000.);
+            static std::pair<UserLib::Jitter_histogram::Snapshot, uint64_t> last[MAX_CAN_BUSES];
+            for (size_t bus = 0; bus < bus_count; bus++) {
+                auto &can_block = buses[bus];
+                auto jitter = can_block.jitter_.snapshot();
+                auto &[prev_jitter, prev_overruns] = last[bus];
+                UserLib::Jitter_histogram::Snapshot window;
+                for (size_t i = 0; i < window.size(); i++) {
+                    window[i] = jitter[i] - prev_jitter[i];
+                }
+                prev_jitter = jitter;
+                auto key = [&](const char *field) { return "dji_motor." + can_block.can_name_ + "." + field; };
+                for (auto [field, p] : { std::pair{ "tx_jitter_p50_us", 0.5 }, { "tx_jitter_p99_us", 0.99 }, { "tx_jitter_max_us", 1. } }) {
+                    logger.push_value(key(field), UserLib::Jitter_histogram::percentile(window, p) / 1e3);
+                }
+                logger.push_value(key("tx_overruns"), (double)(can_block.overruns_ - prev_overruns));
+                prev_overruns = can_block.overruns_;
+                static UserLib::Histogram<20000>::Snapshot last_latency[MAX_CAN_BUSES];
+                auto latency = can_block.commit_to_tx_.snapshot();
+                UserLib::Histogram<20000>::Snapshot latency_window;
+                for (size_t i = 0; i < latency_window.size(); i++) {
+                    latency_window[i] = latency[i] - last_latency[bus][i];
+                }
+                last_latency[bus] = latency;
+                for (auto [field, p] : { std::pair{ "commit_to_tx_p50_us", 0.5 }, { "commit_to_tx_p99_us", 0.99 } }) {
+                    logger.push_value(key(field), UserLib::Histogram<20000>::percentile(latency_window, p) / 1e3);
+                }
+                for (const auto motor : can_block.motors_) {
+                    logger.push_value(
+                        motor->motor_name_ + ".rx_to_control_us",
+                        std::chrono::duration<double, std::micro>(motor->rx_to_control).count());
+                }
+            }
+        }
+#endif
+
+        static void send(CanBlock &can_block) {
+            for (size_t i = 0; i < can_block.entry_count_; i++) {
+                const auto &entry = can_block.entries_[i];
+                auto data = can_block.frames_[entry.frame].data;
+                data[entry.offset] = static_cast<uint16_t>(*entry.current) >> 8;
+                data[entry.offset | 1] = *entry.current & 0xff;
+            }
+            // 同一总线的帧合并为一次 sendmmsg
+            can_block.can_->send(can_block.frames_.data(), can_block.frame_count_);
         }
 
         [[noreturn]] void task() {
-            static can_frame frame[3] = {{}, {}, {}};
-            static bool valid[3] = {false, false, false};
+            int ticks = 0;
+            uint64_t cpu_ns = 0;
             while (true) {
                 data_lock.lock();
-                auto now = std::chrono::steady_clock::now();
-                for (auto &[can_name, can_block]: motors_map) {
-                    if (can_block.can_ == nullptr) {
-                        can_block.can_ = IO::io<CAN>[can_name];
-                    }
-                    if (can_block.can_ == nullptr) {
+                int64_t now = monotonic_ns();
+                int64_t next = now + std::chrono::nanoseconds(std::chrono::milliseconds(1)).count();
+                uint64_t cpu_start = thread_cpu_ns();
+                uint32_t dirty = tx_on_commit ? dirty_buses.exchange(0, std::memory_order_acquire) : 0;
+                for (size_t bus = 0; bus < bus_count; bus++) {
+                    auto &can_block = buses[bus];
+                    if (can_block.frame_count_ == 0) {
                         continue;
                     }
-                    frame[0] = {.can_id = 0x1ff, .len = 8};
-                    frame[1] = {.can_id = 0x200, .len = 8};
-                    frame[2] = {.can_id = 0x2ff, .len = 8};
-                    valid[0] = valid[1] = valid[2] = false;
-                    for (const auto motor: can_block.motors_) {
-                        valid[static_cast<int>(motor->can_info.can_id_)] = true;
-                        auto data = frame[static_cast<int>(motor->can_info.can_id_)].data;
-                        data[motor->can_info.data_bias] = static_cast<uint16_t>(motor->give_current) >> 8;
-                        data[motor->can_info.data_bias | 1] = motor->give_current & 0xff;
+                    if (can_block.deadline_ == 0) {
+                        can_block.deadline_ = now;
+                    }
+                    bool due = can_block.deadline_ <= now;
+                    if (!due && !(dirty & (1u << bus))) {
+                        next = std::min(next, can_block.deadline_);
+                        continue;
                     }
-                    if (valid[0]) {
-                        can_block.can_->send(frame[0]);
+                    if (due) {
+                        can_block.jitter_.record(now - can_block.deadline_);
                     }
-                    if (valid[1]) {
-                        can_block.can_->send(frame[1]);
+                    send(can_block);
+                    if (int64_t committed = can_block.committed_ns_.exchange(0, std::memory_order_relaxed)) {
+                        can_block.commit_to_tx_.record(monotonic_ns() - committed);
                     }
-                    if (valid[2]) {
-                        can_block.can_->send(frame[2]);
+                    int64_t period = can_block.period_.count();
+                    if (!due) {
+                        // 由 commit 触发的发送，周期发送从这次发送起顺延
+                        can_block.deadline_ = now + period;
+                    } else {
+                        // 截止时间按固定周期推进，与唤醒延迟和发送耗时无关；已经错过的周期不补发，计入 overruns_
+                        can_block.deadline_ += period;
+                        if (can_block.deadline_ <= now) {
+                            int64_t missed = (now - can_block.deadline_) / period + 1;
+                            can_block.overruns_ += missed;
+                            can_block.deadline_ += missed * period;
+                        }
                     }
+                    next = std::min(next, can_block.deadline_);
+                }
+                cpu_ns += thread_cpu_ns() - cpu_start;
+                if (++ticks == REPORT_TICKS) {
+                    IFDEF(__DEBUG__, report(ticks, cpu_ns));
+                    ticks = 0;
+                    cpu_ns = 0;
                 }
                 data_lock.unlock();
-                std::this_thread::sleep_until(now + std::chrono::milliseconds(1));
+                timespec deadline{ .tv_sec = next / 1000000000, .tv_nsec = next % 1000000000 };
+                if (!tx_on_commit) {
+                    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+                    }
+                    continue;
+                }
+                // 等到下一个周期截止时间或有 commit；FUTEX_WAIT_BITSET 的超时是 CLOCK_MONOTONIC 的绝对时间
+                if (dirty_buses.load(std::memory_order_acquire) == 0) {
+                    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&dirty_buses), FUTEX_WAIT_BITSET_PRIVATE, 0,
+                            &deadline, nullptr, FUTEX_BITSET_MATCH_ANY);
+                }
+                if (dirty_buses.load(std::memory_order_acquire) != 0 && coalesce_ns > 0) {
+                    // 等待同一批控制线程的其它 commit，合并为一次发送
+                    timespec coalesce{ .tv_sec = 0, .tv_nsec = coalesce_ns };
+                    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &coalesce, &coalesce) == EINTR) {
+                    }
+                }
             }
         }
 
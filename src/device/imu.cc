@@ -1,5 +1,7 @@
 #include "device/imu.hpp"
 
+#include <chrono>
+
 #include "io.hpp"
 #include "serial_interface.hpp"
 #include "user_lib.hpp"
@@ -29,5 +31,27 @@ namespace Device
         // if (serial_name.compare("/dev/IMU_HERO") == 0)
         //     LOG_INFO("imu %.6f %.6f %.6f\n", pkg.yaw, pkg.pitch, pkg.yaw_v);
         update_time();
+        int64_t stamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now().time_since_epoch())
+                               .count();
+        history.push(stamp_ns, Attitude{ yaw, pitch, roll });
+    }
+
+    bool IMU::attitude_at(int64_t stamp_ns, Attitude &attitude) const {
+        Attitude_history::Entry before, after;
+        if (!history.find(stamp_ns, before, after)) {
+            return false;
+        }
+        if (after.stamp_ns == before.stamp_ns) {
+            attitude = before.value;
+            return true;
+        }
+        // 角度在 ±pi 处回绕，按差值插值
+        fp32 k = (fp32)(stamp_ns - before.stamp_ns) / (fp32)(after.stamp_ns - before.stamp_ns);
+        auto lerp = [k](fp32 a, fp32 b) { return UserLib::rad_format(a + k * UserLib::rad_format(b - a)); };
+        attitude.yaw = lerp(before.value.yaw, after.value.yaw);
+        attitude.pitch = lerp(before.value.pitch, after.value.pitch);
+        attitude.roll = lerp(before.value.roll, after.value.roll);
+        return true;
     }
 }  // namespace Device
@@ -22,11 +22,17 @@ namespace Device
             for (int k_i = 0; k_i < k_unpack_buffer_length_; ++k_i)
                 unpack_buffer_[k_i] = temp_buffer[k_i];
         }
-        for (int k_i = 0; k_i < k_unpack_buffer_length_ - k_frame_length_; ++k_i) {
+        // 每帧解析后清除帧头，因此可以扫描整个窗口；不完整的帧留到后续 read 补齐后再解析
+        for (int k_i = 0; k_i < k_unpack_buffer_length_ - k_header_length_; ++k_i) {
             if (unpack_buffer_[k_i] == 0xA5) {
-                frame_len = unpack(&unpack_buffer_[k_i]);
-                if (frame_len != -1)
-                    k_i += frame_len;
+                frame_len = unpack(&unpack_buffer_[k_i], k_unpack_buffer_length_ - k_i);
+                if (frame_len > 0) {
+                    // 窗口每次只滑动新收到的字节，已解析的帧在之后的 read 中仍在窗口内；
+                    // 清除帧头使每帧只处理一次（SHOOT_DATA 等事件帧不能重复计数）
+                    unpack_buffer_[k_i] = 0;
+                    // 循环末尾还会 ++k_i，下一帧紧跟在本帧之后
+                    k_i += frame_len - 1;
+                }
             }
         }
         clearRxBuffer();
@@ -36,7 +42,7 @@ namespace Device
         robot_set = robot;
     }
 
-    int Dji_referee::unpack(uint8_t *rx_data) {
+    int Dji_referee::unpack(uint8_t *rx_data, int available) {
         uint16_t cmd_id;
         int frame_len;
         Referee::FrameHeader frame_header;
@@ -55,6 +61,9 @@ namespace Device
             // << 8 | rx_data[5]);
             frame_len =
                 frame_header.data_length + k_header_length_ + k_cmd_id_length_ + k_tail_length_;
+            if (frame_len > available) {
+                return -1;
+            }
             if (base_.verifyCRC16CheckSum(rx_data, frame_len) == 1) {
                 cmd_id = (rx_data[6] << 8 | rx_data[5]);
                 switch (cmd_id) {
@@ -103,6 +112,16 @@ namespace Device
                         //     robot_set->referee_info.power_heat_data.chassis_power_buffer);
                         break;
                     }
+                    case Referee::RefereeCmdId::SHOOT_DATA_CMD: {
+                        memcpy(
+                            &robot_set->referee_info.shoot_data,
+                            rx_data + 7,
+                            sizeof(Referee::ShootData));
+                        robot_set->bullet_speed.add_sample(
+                            robot_set->referee_info.shoot_data.shooter_id,
+                            robot_set->referee_info.shoot_data.bullet_speed);
+                        break;
+                    }
                     case Referee::RefereeCmdId::BULLET_REMAINING_CMD: {
                         memcpy(
                             &robot_set->referee_info.bullet_allowance_data,
@@ -11,7 +11,7 @@ namespace Device
         robot_set = robot;
         can = IO::io<CAN>[can_name];
         can->register_callback_key(
-            0x51, std::bind(&Super_Cap::unpack, this, std::placeholders::_1));
+            0x51, [this](const can_frame& frame, const IO::Rx_time&) { unpack(frame); });
     }
 
     void Super_Cap::unpack(const can_frame& frame) {
@@ -87,9 +87,43 @@ namespace Gimbal
                 //     return;
                 *yaw_set = vc.yaw_set;
                 *pitch_set = vc.pitch_set;
+                update_aim_target(vc);
                 }
             });
 
+        // 视觉查询曝光时刻的云台姿态；哨兵发给视觉的 yaw 是 fake_yaw_abs，与 IMU 姿态不在同一坐标系，不提供查询
+        IO::io<SOCKET>["AUTO_AIM_CONTROL"]->register_callback_key(
+            config.header, [this](const Robot::Attitude_query &query) {
+                Robot::Attitude_reply reply{ .client = query.client, .seq = query.seq, .valid = false };
+                Device::IMU::Attitude attitude{};
+                if (!ISDEF(CONFIG_SENTRY) && imu.attitude_at(query.stamp_ns, attitude)) {
+                    reply.valid = true;
+                    reply.yaw = attitude.yaw;
+                    reply.pitch = attitude.pitch;
+                    reply.roll = attitude.roll;
+                }
+                IO::io<SOCKET>["AUTO_AIM_CONTROL"]->send_to(query.client, &reply, sizeof(reply));
+            });
+
+        IO::io<SOCKET>["AUTO_AIM_CONTROL"]->register_callback_key(
+            config.tracker_header, [this](const Robot::ReceiveGimbalPacket &target) {
+                int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count();
+                receive_auto_aim = std::chrono::steady_clock::now();
+                if (!robot_set->auto_aim_status) {
+                    return;
+                }
+                robot_set->set_mode(Types::ROBOT_MODE::ROBOT_FOLLOW_GIMBAL);
+                Tracker_state state{ .target = target, .received_ns = now_ns };
+                // 跟踪器与自瞄控制包来自同一个视觉程序，使用同一个时钟同步结果
+                auto sync = IO::io<SOCKET>["AUTO_AIM_CONTROL"]->clock(config.header);
+                if (target.capture_ns != 0 && sync != nullptr) {
+                    state.target.capture_ns = sync->to_local(target.capture_ns);
+                }
+                tracker.store(state);
+            });
+
         std::thread check_auto_aim([this] {
             while (true) {
                 if (robot_set->sentry_follow_gimbal) {
@@ -185,6 +219,7 @@ namespace Gimbal
                 *pitch_set = std::clamp((double)pitch, -0.18, 0.51);
                 *pitch_set >> pitch_absolute_pid >> pitch_motor;
             } else {
+                predict_aim();
                 // NOTE: 抽象双头限位
                 MUXDEF(
                     CONFIG_SENTRY, static float yr; static flz
@@ -208,13 +243,17 @@ namespace Gimbal
                 *pitch_set >> pitch_absolute_pid >> pitch_motor;
                 //LOG_INFO("status::%d\n", robot_set->auto_aim_status);
             }
+            Hardware::DJIMotorManager::commit({ &yaw_motor, &pitch_motor });
             // if (config.gimbal_id == 1)
             // LOG_INFO("%dpitch set %f\n", config.gimbal_id, *pitch_set);
             // LOG_INFO("robot id % d\n", robot_set->referee_info.game_robot_status_data.robot_id);
             Robot::SendAutoAimInfo pkg;
+            Device::IMU::Attitude_history::Entry attitude{};
+            imu.latest(attitude);
             pkg.header = config.header;
-            MUXDEF(CONFIG_SENTRY, pkg.yaw = fake_yaw_abs, pkg.yaw = imu.yaw);
-            pkg.pitch = imu.pitch;
+            MUXDEF(CONFIG_SENTRY, pkg.yaw = fake_yaw_abs, pkg.yaw = attitude.value.yaw);
+            pkg.pitch = attitude.value.pitch;
+            pkg.stamp_ns = attitude.stamp_ns;
             pkg.red = robot_set->referee_info.game_robot_status_data.robot_id < 100;
             IO::io<SOCKET>["AUTO_AIM_CONTROL"]->send(pkg);
 
@@ -222,7 +261,121 @@ namespace Gimbal
         }
     }
 
+    void GimbalT::update_aim_target(const Robot::Auto_aim_control &vc) {
+        if (vc.capture_ns == 0) {
+            aim_target.store(Aim_target{});
+            return;
+        }
+        Aim_target last = aim_target.load();
+        Aim_target target{ .capture_ns = vc.capture_ns,
+                           .yaw = vc.yaw_set,
+                           .pitch = vc.pitch_set,
+                           .yaw_rate = 0,
+                           .pitch_rate = 0 };
+        fp32 dt = (fp32)(vc.capture_ns - last.capture_ns) / 1e9f;
+        // 相邻两帧间隔过长（丢目标、换目标）时不沿用旧的角速度
+        if (last.capture_ns != 0 && dt > 0 && dt < 0.1f) {
+            fp32 yaw_rate = UserLib::rad_format(vc.yaw_set - last.yaw) / dt;
+            fp32 pitch_rate = (vc.pitch_set - last.pitch) / dt;
+            target.yaw_rate = last.yaw_rate + Config::AUTO_AIM_RATE_FILTER * (yaw_rate - last.yaw_rate);
+            target.pitch_rate = last.pitch_rate + Config::AUTO_AIM_RATE_FILTER * (pitch_rate - last.pitch_rate);
+        }
+        aim_target.store(target);
+    }
+
+    void GimbalT::predict_aim() {
+        if (!robot_set->auto_aim_status ||
+            std::chrono::steady_clock::now() - receive_auto_aim > std::chrono::milliseconds(300)) {
+            return;
+        }
+        int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now().time_since_epoch())
+                             .count();
+        if (solve_tracker(now_ns)) {
+            return;
+        }
+        Aim_target target = aim_target.load();
+        if (target.capture_ns == 0) {
+            return;
+        }
+        if (target.capture_ns != applied_capture_ns) {
+            applied_capture_ns = target.capture_ns;
+            IO::io<SOCKET>["AUTO_AIM_CONTROL"]->aim_latency.record(now_ns - target.capture_ns);
+        }
+        // 视觉设定值对应曝光时刻的目标位置，外推到当前控制周期
+        fp32 horizon = std::clamp<fp32>(
+            (fp32)(now_ns - target.capture_ns) / 1e9f, 0.f, Config::AUTO_AIM_MAX_PREDICT_MS / 1e3f);
+        *yaw_set = UserLib::rad_format(target.yaw + target.yaw_rate * horizon);
+        *pitch_set = target.pitch + target.pitch_rate * horizon;
+    }
+
+    bool GimbalT::solve_tracker(int64_t now_ns) {
+        Tracker_state state = tracker.load();
+        const auto &target = state.target;
+        if (state.received_ns == 0 || now_ns - state.received_ns > 300'000'000 || !target.tracking ||
+            target.armors_num == 0) {
+            return false;
+        }
+        int64_t stamp_ns = target.capture_ns != 0 ? target.capture_ns : state.received_ns;
+        if (stamp_ns != applied_capture_ns) {
+            applied_capture_ns = stamp_ns;
+            IO::io<SOCKET>["AUTO_AIM_CONTROL"]->aim_latency.record(now_ns - stamp_ns);
+        }
+        // 按匀速模型把目标预测到当前控制周期，再解算子弹飞行时间内的运动
+        double dt = std::max<double>(0., (double)(now_ns - stamp_ns) / 1e9);
+        Vec3d pos{ target.x + target.vx * dt, target.y + target.vy * dt, target.z + target.vz * dt };
+        Vec3d vel{ target.vx, target.vy, target.vz };
+        // 裁判系统的 shooter_id：1、2 为 17mm 发射机构，3 为 42mm
+        fp32 bullet_speed =
+            robot_set->bullet_speed.speed(MUXDEF(CONFIG_HERO, 3, config.gimbal_id), Config::AUTO_AIM_BULLET_SPEED);
+        // 同时解算所有装甲板，选择云台转动量最小的一块；目标转速过高无法逐块跟踪时由 solve 瞄准中心
+        Control::ArmorSolutions armors;
+        int selected = -1;
+        if (bullet_solver.tracksTarget(target.v_yaw) &&
+            bullet_solver.solveArmors(
+                pos,
+                vel,
+                bullet_speed,
+                target.yaw + target.v_yaw * dt,
+                target.v_yaw,
+                target.r1,
+                target.r2,
+                target.dz,
+                target.armors_num,
+                imu.yaw,
+                imu.pitch,
+                armors) > 0) {
+            selected = bullet_solver.selectArmor(armors);
+        }
+        if (selected >= 0) {
+            *yaw_set = armors.yaw[selected];
+            *pitch_set = armors.pitch[selected];
+        } else {
+            bool solved = bullet_solver.solve(
+                pos,
+                vel,
+                bullet_speed,
+                target.yaw + target.v_yaw * dt,
+                target.v_yaw,
+                target.r1,
+                target.r2,
+                target.dz,
+                target.armors_num);
+            if (!solved) {
+                robot_set->cv_fire = false;
+                return true;
+            }
+            *yaw_set = (fp32)bullet_solver.getYaw();
+            *pitch_set = (fp32)bullet_solver.getPitch();
+        }
+        robot_set->cv_fire = std::fabs(UserLib::rad_format(*yaw_set - imu.yaw)) < Config::AUTO_AIM_FIRE_TOLERANCE &&
+                             std::fabs(*pitch_set - imu.pitch) < Config::AUTO_AIM_FIRE_TOLERANCE;
+        return true;
+    }
+
     void GimbalT::update_data() {
+        yaw_motor.update();
+        pitch_motor.update();
         yaw_relative = UserLib::rad_format(
             yaw_motor.data_.rotor_angle - Hardware::DJIMotor::ECD_8192_TO_RAD * config.YawOffSet);
         yaw_gyro = (std::cos(imu.pitch) * imu.yaw_rate - std::sin(imu.pitch) * imu.roll_rate);
@@ -1,7 +1,17 @@
 #include "can.hpp"
 
+#include <linux/can/error.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
+#include <ctime>
+#include <fstream>
+#include <thread>
 
+#include "macro_helpers.hpp"
+#include "recorder.hpp"
 #include "utils.hpp"
 
 namespace IO
@@ -11,7 +21,17 @@ namespace IO
         ifr = new ifreq;
         soket_id = -1;
         init_flag = false;
-        init(name.c_str());
+        for (int i = 0; i < BATCH_SIZE; i++) {
+            rx_iov[i] = { .iov_base = &frame_r[i], .iov_len = sizeof(Rx_frame) };
+            rx_msgs[i] = {};
+            rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+            rx_msgs[i].msg_hdr.msg_iovlen = 1;
+            rx_msgs[i].msg_hdr.msg_control = rx_control[i];
+        }
+        record_source = recorder.add_source(Source_type::CAN, name);
+        if (!replaying) {
+            init(name.c_str());
+        }
     }
 
     void Can_interface::init(const char *can_channel) {
@@ -32,33 +52,250 @@ namespace IO
             perror("Error in socket bind");
             exit(-1);
         }
+        // 让内核在每帧上附带接收时间
+        int enable = 1;
+        if (setsockopt(soket_id, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0) {
+            LOG_ERR("CAN error[%s]: SO_TIMESTAMPNS unsupported, use user space time\n", can_channel);
+        }
+        // 在任何设备注册之前不接收任何帧
+        apply_filter();
+        // 错误帧不受 CAN_RAW_FILTER 影响，单独打开用于统计总线错误与 bus-off
+        can_err_mask_t err_mask = CAN_ERR_MASK;
+        if (setsockopt(soket_id, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &err_mask, sizeof(err_mask)) < 0) {
+            LOG_ERR("CAN error[%s]: failed to enable error frames\n", can_channel);
+        }
+        iface_base = iface_stats();
         init_flag = true;
     }
 
+    void Can_interface::add_filter(uint32_t key) {
+        std::unique_lock lock(filter_lock);
+        for (const auto &filter : filters) {
+            if (filter.can_id == key) {
+                return;
+            }
+        }
+        // 精确匹配 ID，同时要求 EFF/RTR 标志与 key 一致
+        canid_t id_mask = (key & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK;
+        filters.push_back({ .can_id = key, .can_mask = id_mask | CAN_EFF_FLAG | CAN_RTR_FLAG });
+        apply_filter();
+    }
+
+    void Can_interface::apply_filter() {
+        // 回放模式没有打开 socket
+        if (soket_id < 0) {
+            return;
+        }
+        if (filters.size() > CAN_RAW_FILTER_MAX) {
+            // 长度为 0 的过滤表表示不接收任何帧，接收全部帧需要一条 mask 为 0 的过滤规则
+            LOG_ERR("CAN error[%s]: too many filters, kernel filter disabled\n", name.c_str());
+            can_filter accept_all{ .can_id = 0, .can_mask = 0 };
+            setsockopt(soket_id, SOL_CAN_RAW, CAN_RAW_FILTER, &accept_all, sizeof(accept_all));
+            return;
+        }
+        if (setsockopt(
+                soket_id,
+                SOL_CAN_RAW,
+                CAN_RAW_FILTER,
+                filters.data(),
+                filters.size() * sizeof(can_filter)) < 0) {
+            LOG_ERR("CAN error[%s]: failed to apply CAN_RAW_FILTER\n", name.c_str());
+        }
+    }
+
+    uint64_t Can_interface::read_iface_stat(const char *stat) const {
+        std::ifstream file("/sys/class/net/" + name + "/statistics/" + stat);
+        uint64_t value = 0;
+        file >> value;
+        return value;
+    }
+
+    Iface_stats Can_interface::iface_stats() const {
+        return { .rx_packets = read_iface_stat("rx_packets") - iface_base.rx_packets,
+                 .rx_bytes = read_iface_stat("rx_bytes") - iface_base.rx_bytes,
+                 .tx_packets = read_iface_stat("tx_packets") - iface_base.tx_packets,
+                 .tx_bytes = read_iface_stat("tx_bytes") - iface_base.tx_bytes };
+    }
+
+    void Can_interface::on_error_frame(const can_frame &frame) {
+        stats.err_frames.fetch_add(1, std::memory_order_relaxed);
+        if (frame.can_id & CAN_ERR_BUSOFF) {
+            stats.bus_off.fetch_add(1, std::memory_order_relaxed);
+            stats.bus_off_state.store(true, std::memory_order_relaxed);
+            LOG_ERR("CAN error[%s]: bus off\n", name.c_str());
+        }
+        if (frame.can_id & CAN_ERR_RESTARTED) {
+            stats.bus_off_state.store(false, std::memory_order_relaxed);
+        }
+    }
+
     Can_interface::~Can_interface() {
         delete addr;
         delete ifr;
     }
 
+    int Can_interface::receive(int flags) {
+        for (auto &msg : rx_msgs) {
+            msg.msg_hdr.msg_controllen = sizeof(rx_control[0]);
+        }
+        int n = recvmmsg(soket_id, rx_msgs, BATCH_SIZE, flags, nullptr);
+        if (n <= 0) {
+            return n;
+        }
+        // 内核时间戳是 CLOCK_REALTIME，按当前两个时钟的差值换算到 steady_clock
+        timespec real_now{};
+        clock_gettime(CLOCK_REALTIME, &real_now);
+        auto steady_now = std::chrono::steady_clock::now();
+        stats.rx_syscalls.fetch_add(1, std::memory_order_relaxed);
+        int data_frames = 0;
+        for (int i = 0; i < n; i++) {
+            if (frame_r[i].classic.can_id & CAN_ERR_FLAG) {
+                on_error_frame(frame_r[i].classic);
+                continue;
+            }
+            data_frames++;
+            recorder.record(record_source, &frame_r[i], rx_msgs[i].msg_len);
+            Rx_time stamp = steady_now;
+            for (cmsghdr *cmsg = CMSG_FIRSTHDR(&rx_msgs[i].msg_hdr); cmsg != nullptr;
+                 cmsg = CMSG_NXTHDR(&rx_msgs[i].msg_hdr, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                    timespec ts;
+                    memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                    auto age = std::chrono::seconds(real_now.tv_sec - ts.tv_sec) +
+                               std::chrono::nanoseconds(real_now.tv_nsec - ts.tv_nsec);
+                    if (age.count() >= 0) {
+                        stamp = steady_now - std::chrono::duration_cast<Rx_time::duration>(age);
+                    }
+                }
+            }
+            bool handled = rx_msgs[i].msg_len == CANFD_MTU
+                               ? fd_callbacks.callback_key(frame_r[i].fd.can_id, frame_r[i].fd, stamp)
+                               : callback_key(frame_r[i].classic.can_id, frame_r[i].classic, stamp);
+            if (!handled) {
+                stats.rx_unhandled.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        stats.rx_frames.fetch_add(data_frames, std::memory_order_relaxed);
+        IFDEF(
+            __DEBUG__,
+            stats.dispatch_ns.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - steady_now)
+                    .count(),
+                std::memory_order_relaxed));
+        return n;
+    }
+
+    void Can_interface::replay(const uint8_t *data, size_t len) {
+        auto stamp = std::chrono::steady_clock::now();
+        if (len == CANFD_MTU) {
+            canfd_frame frame;
+            memcpy(&frame, data, sizeof(frame));
+            fd_callbacks.callback_key(frame.can_id, frame, stamp);
+        } else if (len == CAN_MTU) {
+            can_frame frame;
+            memcpy(&frame, data, sizeof(frame));
+            callback_key(frame.can_id, frame, stamp);
+        }
+    }
+
     bool Can_interface::task() {
+        bool failing = false;
         for (;;) {
             if (init_flag) {
-                // read CAN frame
-                if (read(soket_id, &frame_r, sizeof(can_frame)) <= 0) {
-                    LOG_ERR("Error reading CAN frame\n");
-                    return Status::ERROR;
-                } else {
-                    // printf("not reading!\n");
+                // block until at least one frame arrives, then drain everything already queued
+                if (receive(MSG_WAITFORONE) > 0) {
+                    failing = false;
+                    continue;
                 }
-                callback_key(frame_r.can_id, frame_r);
+                if (errno == EINTR) {
+                    continue;
+                }
+                // 网卡 down / bus-off 时读会失败，记录后继续等待恢复而不是退出线程
+                stats.rx_errors.fetch_add(1, std::memory_order_relaxed);
+                if (!failing) {
+                    LOG_ERR("CAN error[%s]: read failed: %s\n", name.c_str(), strerror(errno));
+                    failing = true;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
+
+    bool Can_interface::on_readable() {
+        if (receive(MSG_DONTWAIT) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            stats.rx_errors.fetch_add(1, std::memory_order_relaxed);
+            if (errno == EBADF || errno == ENOTSOCK) {
+                LOG_ERR("CAN error[%s]: read failed: %s\n", name.c_str(), strerror(errno));
+                return Status::ERROR;
             }
         }
+        return Status::OK;
     }
 
     bool Can_interface::send(const can_frame &frame) {
         /* send CAN frame */
-        write(soket_id, &frame, sizeof(can_frame));
-        return true;
+        auto n = write(soket_id, &frame, sizeof(can_frame));
+        stats.tx_syscalls.fetch_add(1, std::memory_order_relaxed);
+        if (n != sizeof(can_frame)) {
+            stats.tx_errors.fetch_add(1, std::memory_order_relaxed);
+            stats.tx_dropped.fetch_add(1, std::memory_order_relaxed);
+            return Status::ERROR;
+        }
+        stats.tx_frames.fetch_add(1, std::memory_order_relaxed);
+        return Status::OK;
+    }
+
+    bool Can_interface::enable_fd() {
+        int enable = 1;
+        if (setsockopt(soket_id, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) < 0) {
+            LOG_ERR("CAN error[%s]: failed to enable CAN FD frames\n", name.c_str());
+            return Status::ERROR;
+        }
+        fd_mode = true;
+        return Status::OK;
+    }
+
+    bool Can_interface::send(const canfd_frame &frame) {
+        if (!fd_mode) {
+            LOG_ERR("CAN error[%s]: CAN FD is not enabled\n", name.c_str());
+            return Status::ERROR;
+        }
+        auto n = write(soket_id, &frame, CANFD_MTU);
+        stats.tx_syscalls.fetch_add(1, std::memory_order_relaxed);
+        if (n != CANFD_MTU) {
+            stats.tx_errors.fetch_add(1, std::memory_order_relaxed);
+            stats.tx_dropped.fetch_add(1, std::memory_order_relaxed);
+            return Status::ERROR;
+        }
+        stats.tx_frames.fetch_add(1, std::memory_order_relaxed);
+        return Status::OK;
+    }
+
+    bool Can_interface::send(const can_frame *frames, size_t n) {
+        iovec iov[BATCH_SIZE];
+        mmsghdr msgs[BATCH_SIZE];
+        size_t sent = 0;
+        while (sent < n) {
+            size_t len = std::min(n - sent, static_cast<size_t>(BATCH_SIZE));
+            for (size_t i = 0; i < len; i++) {
+                iov[i] = { .iov_base = const_cast<can_frame *>(&frames[sent + i]),
+                           .iov_len = sizeof(can_frame) };
+                msgs[i] = {};
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            int ret = sendmmsg(soket_id, msgs, len, 0);
+            stats.tx_syscalls.fetch_add(1, std::memory_order_relaxed);
+            if (ret <= 0) {
+                stats.tx_errors.fetch_add(1, std::memory_order_relaxed);
+                stats.tx_dropped.fetch_add(n - sent, std::memory_order_relaxed);
+                return Status::ERROR;
+            }
+            stats.tx_frames.fetch_add(ret, std::memory_order_relaxed);
+            sent += ret;
+        }
+        return Status::OK;
     }
 
 }  // namespace IO
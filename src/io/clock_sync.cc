@@ -0,0 +1,71 @@
+#include "clock_sync.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace IO
+{
+    // 正常晶振的漂移在几十 ppm 以内，超出时认为拟合受噪声影响，不采用
+    constexpr double MAX_DRIFT = 500e-6;
+    // 延迟不超过 最小延迟 + max(最小延迟 / 2, 50us) 的样本参与拟合
+    constexpr int64_t MIN_DELAY_MARGIN = 50000;
+
+    void Clock_sync::add_sample(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+        std::lock_guard guard(lock);
+        samples[count % SAMPLES] = Sample{
+            .local = t1 + (t4 - t1) / 2,
+            .offset = ((t2 - t1) + (t3 - t4)) / 2,
+            .delay = std::max<int64_t>(0, (t4 - t1) - (t3 - t2)),
+        };
+        int64_t ref = samples[count % SAMPLES].local;
+        count++;
+        size_t n = std::min(count, SAMPLES);
+
+        int64_t min_delay = samples[0].delay;
+        for (size_t i = 1; i < n; i++) {
+            min_delay = std::min(min_delay, samples[i].delay);
+        }
+        int64_t threshold = min_delay + std::max(min_delay / 2, MIN_DELAY_MARGIN);
+
+        // 以最新样本为原点拟合 offset = a + b * (local - ref)
+        double sx = 0, sy = 0;
+        size_t used = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (samples[i].delay <= threshold) {
+                sx += (double)(samples[i].local - ref);
+                sy += (double)samples[i].offset;
+                used++;
+            }
+        }
+        double mx = sx / used, my = sy / used;
+        double sxx = 0, sxy = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (samples[i].delay <= threshold) {
+                double dx = (double)(samples[i].local - ref) - mx;
+                sxx += dx * dx;
+                sxy += dx * ((double)samples[i].offset - my);
+            }
+        }
+        double drift = used >= 3 && sxx > 0 ? sxy / sxx : 0;
+        if (std::fabs(drift) > MAX_DRIFT) {
+            drift = 0;
+        }
+        published.store(Estimate{
+            .valid = true,
+            .local_ref = ref,
+            .offset_ref = (int64_t)std::llround(my - drift * mx),
+            .drift = drift,
+            .min_delay = min_delay,
+        });
+    }
+
+    int64_t Clock_sync::to_local(int64_t remote_ns) const {
+        Estimate e = published.load();
+        if (!e.valid) {
+            return remote_ns;
+        }
+        // 先用参考点的偏移估计本地时间，再用该时刻的偏移修正一次，漂移很小，一次即可
+        int64_t local = remote_ns - e.offset_ref;
+        return remote_ns - e.offset_ref - (int64_t)std::llround(e.drift * (double)(local - e.local_ref));
+    }
+}  // namespace IO
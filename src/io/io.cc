@@ -3,5 +3,221 @@
 //
 #include "io.hpp"
 
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "logger.hpp"
+#include "macro_helpers.hpp"
+#include "serial_interface.hpp"
+#include "socket_interface.hpp"
+
 namespace IO {
+
+    using Values = std::vector<std::pair<std::string, double>>;
+
+    // 按帧数与数据字节数估算总线上的位数：标准帧 47 位开销（含帧间隔），填充位按 10% 估计
+    static double estimate_bits(uint64_t frames, uint64_t bytes) {
+        return (47. * frames + 8. * bytes) * 1.1;
+    }
+
+    static void report_can(Values &values) {
+        struct Sample
+        {
+            uint64_t tx_frames, tx_syscalls, rx_frames, rx_syscalls, rx_unhandled, dispatch_ns;
+            uint64_t rx_errors, tx_errors, tx_dropped, err_frames, bus_off;
+            Iface_stats iface;
+        };
+        static std::unordered_map<std::string, Sample> last;
+        for (const auto &[name, can] : io<CAN>) {
+            auto &stats = can->stats;
+            Sample now = { stats.tx_frames.load(std::memory_order_relaxed),
+                           stats.tx_syscalls.load(std::memory_order_relaxed),
+                           stats.rx_frames.load(std::memory_order_relaxed),
+                           stats.rx_syscalls.load(std::memory_order_relaxed),
+                           stats.rx_unhandled.load(std::memory_order_relaxed),
+                           stats.dispatch_ns.load(std::memory_order_relaxed),
+                           stats.rx_errors.load(std::memory_order_relaxed),
+                           stats.tx_errors.load(std::memory_order_relaxed),
+                           stats.tx_dropped.load(std::memory_order_relaxed),
+                           stats.err_frames.load(std::memory_order_relaxed),
+                           stats.bus_off.load(std::memory_order_relaxed),
+                           can->iface_stats() };
+            auto &prev = last[name];
+            auto key = [&](const char *field) { return "can." + name + "." + field; };
+            uint64_t rx_syscalls = now.rx_syscalls - prev.rx_syscalls;
+            uint64_t rx_frames = now.rx_frames - prev.rx_frames;
+            uint64_t bus_rx_frames = now.iface.rx_packets - prev.iface.rx_packets;
+            uint64_t bus_tx_frames = now.iface.tx_packets - prev.iface.tx_packets;
+            double bus_bits =
+                estimate_bits(bus_rx_frames, now.iface.rx_bytes - prev.iface.rx_bytes) +
+                estimate_bits(bus_tx_frames, now.iface.tx_bytes - prev.iface.tx_bytes);
+            values.emplace_back(key("tx_frames"), (double)(now.tx_frames - prev.tx_frames));
+            values.emplace_back(key("tx_syscalls"), (double)(now.tx_syscalls - prev.tx_syscalls));
+            values.emplace_back(key("rx_syscalls"), (double)rx_syscalls);
+            values.emplace_back(key("rx_frames_per_syscall"), rx_syscalls ? (double)rx_frames / rx_syscalls : 0.);
+            values.emplace_back(
+                key("dispatch_ns_per_frame"),
+                rx_frames ? (double)(now.dispatch_ns - prev.dispatch_ns) / rx_frames : 0.);
+            // 内核过滤掉的帧 = 网卡收到的帧 - 送到用户态的帧
+            values.emplace_back(key("rx_delivered"), (double)rx_frames);
+            values.emplace_back(
+                key("rx_filtered"), bus_rx_frames > rx_frames ? (double)(bus_rx_frames - rx_frames) : 0.);
+            values.emplace_back(key("rx_unhandled"), (double)(now.rx_unhandled - prev.rx_unhandled));
+            // 网卡层面的收发帧率与负载率，包含其他进程的帧
+            values.emplace_back(key("bus_rx_fps"), (double)bus_rx_frames);
+            values.emplace_back(key("bus_tx_fps"), (double)bus_tx_frames);
+            values.emplace_back(key("load_pct"), bus_bits / Can_interface::BITRATE * 100.);
+            values.emplace_back(key("rx_errors"), (double)(now.rx_errors - prev.rx_errors));
+            values.emplace_back(key("tx_errors"), (double)(now.tx_errors - prev.tx_errors));
+            values.emplace_back(key("tx_dropped"), (double)(now.tx_dropped - prev.tx_dropped));
+            values.emplace_back(key("err_frames"), (double)(now.err_frames - prev.err_frames));
+            values.emplace_back(key("bus_off"), (double)(now.bus_off - prev.bus_off));
+            values.emplace_back(key("bus_off_state"), stats.bus_off_state.load(std::memory_order_relaxed) ? 1. : 0.);
+            prev = now;
+        }
+    }
+
+    static void report_serial(Values &values) {
+        struct Sample
+        {
+            uint64_t rx_bytes, read_syscalls, packets, skipped_bytes, parse_ns;
+            uint64_t crc_errors, length_errors, unknown_ids, dropped, legacy_packets;
+        };
+        static std::unordered_map<std::string, Sample> last;
+        for (const auto &[name, serial] : io<SERIAL>) {
+            auto &stats = serial->stats;
+            Sample now = { stats.rx_bytes.load(std::memory_order_relaxed),
+                           stats.read_syscalls.load(std::memory_order_relaxed),
+                           stats.packets.load(std::memory_order_relaxed),
+                           stats.skipped_bytes.load(std::memory_order_relaxed),
+                           stats.parse_ns.load(std::memory_order_relaxed),
+                           stats.crc_errors.load(std::memory_order_relaxed),
+                           stats.length_errors.load(std::memory_order_relaxed),
+                           stats.unknown_ids.load(std::memory_order_relaxed),
+                           stats.dropped.load(std::memory_order_relaxed),
+                           stats.legacy_packets.load(std::memory_order_relaxed) };
+            auto &prev = last[name];
+            auto key = [&](const char *field) { return "serial." + name + "." + field; };
+            uint64_t packets = now.packets - prev.packets;
+            values.emplace_back(key("rx_bytes"), (double)(now.rx_bytes - prev.rx_bytes));
+            values.emplace_back(key("read_syscalls"), (double)(now.read_syscalls - prev.read_syscalls));
+            values.emplace_back(key("packets"), (double)packets);
+            values.emplace_back(key("skipped_bytes"), (double)(now.skipped_bytes - prev.skipped_bytes));
+            values.emplace_back(
+                key("parse_ns_per_packet"), packets ? (double)(now.parse_ns - prev.parse_ns) / packets : 0.);
+            values.emplace_back(key("crc_errors"), (double)(now.crc_errors - prev.crc_errors));
+            values.emplace_back(key("length_errors"), (double)(now.length_errors - prev.length_errors));
+            values.emplace_back(key("unknown_ids"), (double)(now.unknown_ids - prev.unknown_ids));
+            values.emplace_back(key("dropped"), (double)(now.dropped - prev.dropped));
+            values.emplace_back(key("legacy_packets"), (double)(now.legacy_packets - prev.legacy_packets));
+            prev = now;
+        }
+    }
+
+    static void report_socket(Values &values) {
+        struct Sample
+        {
+            uint64_t rx_packets, rx_wakeups, rx_invalid, rx_overflow, tx_packets, tx_errors, shm_rx, shm_tx, shm_dropped;
+        };
+        static std::unordered_map<std::string, Sample> last;
+        for (const auto &[name, socket] : io<SOCKET>) {
+            auto &stats = socket->stats;
+            Sample now = { stats.rx_packets.load(std::memory_order_relaxed),
+                           stats.rx_wakeups.load(std::memory_order_relaxed),
+                           stats.rx_invalid.load(std::memory_order_relaxed),
+                           stats.rx_overflow.load(std::memory_order_relaxed),
+                           stats.tx_packets.load(std::memory_order_relaxed),
+                           stats.tx_errors.load(std::memory_order_relaxed),
+                           stats.shm_rx.load(std::memory_order_relaxed),
+                           stats.shm_tx.load(std::memory_order_relaxed),
+                           stats.shm_dropped.load(std::memory_order_relaxed) };
+            auto &prev = last[name];
+            auto key = [&](const char *field) { return "socket." + name + "." + field; };
+            uint64_t rx_packets = now.rx_packets - prev.rx_packets;
+            uint64_t rx_wakeups = now.rx_wakeups - prev.rx_wakeups;
+            values.emplace_back(key("rx_packets"), (double)rx_packets);
+            values.emplace_back(key("packets_per_wakeup"), rx_wakeups ? (double)rx_packets / rx_wakeups : 0.);
+            values.emplace_back(key("rx_invalid"), (double)(now.rx_invalid - prev.rx_invalid));
+            values.emplace_back(key("rx_overflow"), (double)(now.rx_overflow - prev.rx_overflow));
+            values.emplace_back(key("tx_packets"), (double)(now.tx_packets - prev.tx_packets));
+            values.emplace_back(key("tx_errors"), (double)(now.tx_errors - prev.tx_errors));
+            values.emplace_back(key("shm_rx"), (double)(now.shm_rx - prev.shm_rx));
+            values.emplace_back(key("shm_tx"), (double)(now.shm_tx - prev.shm_tx));
+            values.emplace_back(key("shm_dropped"), (double)(now.shm_dropped - prev.shm_dropped));
+            prev = now;
+
+            // 最近一秒的曝光到电机控制延迟分布
+            static std::unordered_map<std::string, UserLib::Latency_histogram::Snapshot> last_latency;
+            auto latency = socket->aim_latency.snapshot();
+            auto &prev_latency = last_latency[name];
+            UserLib::Latency_histogram::Snapshot window;
+            uint64_t samples = 0;
+            for (size_t i = 0; i < window.size(); i++) {
+                window[i] = latency[i] - prev_latency[i];
+                samples += window[i];
+            }
+            prev_latency = latency;
+            values.emplace_back(key("aim_latency.samples"), (double)samples);
+            for (auto [field, p] : { std::pair{ "aim_latency.p50_ms", 0.5 }, { "aim_latency.p90_ms", 0.9 }, { "aim_latency.p99_ms", 0.99 } }) {
+                values.emplace_back(key(field), UserLib::Latency_histogram::percentile(window, p) / 1e6);
+            }
+
+            for (size_t client = 0; client < 256; client++) {
+                auto sync = socket->clock(client);
+                if (sync == nullptr) {
+                    continue;
+                }
+                auto estimate = sync->estimate();
+                auto clock_key = [&](const char *field) { return key("clock.") + std::to_string(client) + "." + field; };
+                values.emplace_back(clock_key("valid"), estimate.valid ? 1. : 0.);
+                values.emplace_back(clock_key("offset_us"), estimate.offset_ref / 1e3);
+                values.emplace_back(clock_key("drift_ppm"), estimate.drift * 1e6);
+                values.emplace_back(clock_key("min_delay_us"), estimate.min_delay / 1e3);
+            }
+        }
+    }
+
+    static void report_context_switches(Values &values) {
+        static long last = 0;
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        long now = usage.ru_nvcsw + usage.ru_nivcsw;
+        values.emplace_back(
+            mode == Mode::REACTOR ? "io.reactor.ctx_switches" : "io.thread.ctx_switches", (double)(now - last));
+        last = now;
+    }
+
+    // 先写临时文件再 rename，读取端不会看到写了一半的内容
+    static void write_stats_file(const Values &values) {
+        std::string tmp = std::string(STATS_FILE) + ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::trunc);
+            if (!file) {
+                return;
+            }
+            for (const auto &[key, value] : values) {
+                file << key << ' ' << value << '\n';
+            }
+        }
+        std::rename(tmp.c_str(), STATS_FILE);
+    }
+
+    void report_task() {
+        auto next = std::chrono::steady_clock::now();
+        while (true) {
+            next += std::chrono::seconds(1);
+            std::this_thread::sleep_until(next);
+            Values values;
+            report_can(values);
+            report_serial(values);
+            report_socket(values);
+            report_context_switches(values);
+            write_stats_file(values);
+            IFDEF(__DEBUG__, for (const auto &[key, value] : values) { logger.push_value(key, value); });
+        }
+    }
 }
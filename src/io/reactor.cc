@@ -0,0 +1,80 @@
+#include "reactor.hpp"
+
+#include <pthread.h>
+#include <sys/epoll.h>
+
+#include <cerrno>
+
+#include "types.hpp"
+#include "utils.hpp"
+
+namespace IO
+{
+    Reactor::~Reactor() {
+        for (auto &thread : threads) {
+            thread.detach();
+        }
+    }
+
+    void Reactor::start(int thread_num, int cpu) {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            LOG_ERR("IO error: can't create epoll fd\n");
+            exit(-1);
+        }
+        oneshot = thread_num > 1;
+        for (int i = 0; i < thread_num; i++) {
+            auto &thread = threads.emplace_back(&Reactor::task, this);
+            if (cpu >= 0) {
+                cpu_set_t cpu_set;
+                CPU_ZERO(&cpu_set);
+                CPU_SET(cpu + i, &cpu_set);
+                if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set) != 0) {
+                    LOG_ERR("IO error: can't pin reactor thread %d to cpu %d\n", i, cpu + i);
+                }
+            }
+        }
+    }
+
+    void Reactor::add(int fd, const std::string &name, const std::function<bool()> &handler) {
+        std::unique_lock lock(handlers_lock);
+        auto &p = handlers.emplace_back(std::make_unique<Handler>(fd, name, handler));
+        epoll_event event{};
+        event.events = EPOLLIN;
+        if (oneshot) {
+            event.events |= EPOLLONESHOT;
+        }
+        event.data.ptr = p.get();
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            LOG_ERR("IO error: can't add %s to reactor\n", name.c_str());
+        }
+    }
+
+    void Reactor::task() {
+        constexpr int MAX_EVENTS = 16;
+        epoll_event events[MAX_EVENTS];
+        while (true) {
+            int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+            if (n < 0) {
+                if (errno != EINTR) {
+                    LOG_ERR("IO error: epoll_wait failed\n");
+                }
+                continue;
+            }
+            for (int i = 0; i < n; i++) {
+                auto handler = static_cast<Handler *>(events[i].data.ptr);
+                if (handler->fun() == Status::ERROR) {
+                    LOG_ERR("IO error: %s stopped, remove from reactor\n", handler->name.c_str());
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, handler->fd, nullptr);
+                    continue;
+                }
+                if (oneshot) {
+                    epoll_event event{};
+                    event.events = EPOLLIN | EPOLLONESHOT;
+                    event.data.ptr = handler;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, handler->fd, &event);
+                }
+            }
+        }
+    }
+}  // namespace IO
@@ -0,0 +1,198 @@
+#include "recorder.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "io.hpp"
+#include "serial_interface.hpp"
+#include "socket_interface.hpp"
+#include "utils.hpp"
+
+namespace IO
+{
+    static_assert(sizeof(Recorder::File_header) <= Recorder::HEADER_SIZE);
+    static_assert(sizeof(Recorder::Slot) == Recorder::SLOT_SIZE);
+
+    constexpr char MAGIC[8] = "GKDREC1";
+
+    Recorder::~Recorder() {
+        if (header != nullptr) {
+            munmap(header, map_size);
+        }
+    }
+
+    bool Recorder::open(const std::string &path, size_t size) {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            LOG_ERR("Recorder error: can't open %s\n", path.c_str());
+            return Status::ERROR;
+        }
+        size_t slot_count = (size - HEADER_SIZE) / SLOT_SIZE;
+        map_size = HEADER_SIZE + slot_count * SLOT_SIZE;
+        // 预先分配磁盘空间，避免记录过程中因缺页写入而分配块
+        if (posix_fallocate(fd, 0, static_cast<off_t>(map_size)) != 0) {
+            LOG_ERR("Recorder error: can't allocate %zu bytes for %s\n", map_size, path.c_str());
+            ::close(fd);
+            return Status::ERROR;
+        }
+        void *p = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            LOG_ERR("Recorder error: can't mmap %s\n", path.c_str());
+            return Status::ERROR;
+        }
+        header = static_cast<File_header *>(p);
+        slots = reinterpret_cast<Slot *>(static_cast<uint8_t *>(p) + HEADER_SIZE);
+        memcpy(header->magic, MAGIC, sizeof(MAGIC));
+        header->slot_count = slot_count;
+        header->next_slot.store(0, std::memory_order_relaxed);
+        header->source_count = 0;
+        LOG_INFO("recorder: %s, %zu slots\n", path.c_str(), slot_count);
+        return Status::OK;
+    }
+
+    int Recorder::add_source(Source_type type, const std::string &name) {
+        if (header == nullptr || header->source_count >= MAX_SOURCES) {
+            return -1;
+        }
+        auto &source = header->sources[header->source_count];
+        source.type = type;
+        strncpy(source.name, name.c_str(), sizeof(source.name) - 1);
+        return static_cast<int>(header->source_count++);
+    }
+
+    void Recorder::record(int source, const void *data, size_t len) {
+        if (header == nullptr || source < 0 || len > MAX_RECORD) {
+            return;
+        }
+        size_t n = slots_for(len);
+        uint64_t first = header->next_slot.fetch_add(n, std::memory_order_relaxed);
+        Record_head head{
+            .time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count(),
+            .len = static_cast<uint16_t>(len),
+            .source = static_cast<uint8_t>(source),
+            .reserved = {},
+        };
+        auto src = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < n; i++) {
+            uint64_t index = first + i;
+            Slot &slot = slots[index % header->slot_count];
+            size_t offset = 0;
+            if (i == 0) {
+                memcpy(slot.data, &head, sizeof(head));
+                offset = sizeof(head);
+            }
+            size_t chunk = std::min(len, sizeof(slot.data) - offset);
+            memcpy(slot.data + offset, src, chunk);
+            src += chunk;
+            len -= chunk;
+            slot.tag.store(index << 2 | (i == 0 ? TAG_HEAD : TAG_BODY), std::memory_order_release);
+        }
+    }
+
+    static void replay_record(const Recorder::Source &source, const uint8_t *data, size_t len) {
+        switch (source.type) {
+            case Source_type::CAN:
+                if (auto can = io<CAN>[source.name]) {
+                    can->replay(data, len);
+                }
+                break;
+            case Source_type::SERIAL:
+                if (auto serial = io<SERIAL>[source.name]) {
+                    serial->replay(data, len);
+                }
+                break;
+            case Source_type::SOCKET:
+                if (auto socket = io<SOCKET>[source.name]) {
+                    socket->replay(data, len);
+                }
+                break;
+        }
+    }
+
+    static void replay_task(std::string path, double speed) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            LOG_ERR("Replay error: can't open %s\n", path.c_str());
+            return;
+        }
+        off_t size = lseek(fd, 0, SEEK_END);
+        void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED || size < static_cast<off_t>(Recorder::HEADER_SIZE)) {
+            LOG_ERR("Replay error: can't mmap %s\n", path.c_str());
+            return;
+        }
+        auto header = static_cast<const Recorder::File_header *>(p);
+        auto slots = reinterpret_cast<const Recorder::Slot *>(static_cast<const uint8_t *>(p) + Recorder::HEADER_SIZE);
+        if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+            LOG_ERR("Replay error: %s is not a recording\n", path.c_str());
+            munmap(p, size);
+            return;
+        }
+        uint64_t count = header->slot_count;
+        uint64_t end = header->next_slot.load(std::memory_order_acquire);
+        uint64_t index = end > count ? end - count : 0;
+
+        uint8_t buffer[Recorder::MAX_RECORD];
+        bool started = false;
+        int64_t first_ns = 0;
+        auto start = std::chrono::steady_clock::now();
+        uint64_t records = 0, broken = 0;
+        while (index < end) {
+            const auto &slot = slots[index % count];
+            // 开头可能是被覆盖了一半的记录，跳过所有不是记录起点的 slot
+            if (slot.tag.load(std::memory_order_acquire) != (index << 2 | Recorder::TAG_HEAD)) {
+                index++;
+                continue;
+            }
+            Recorder::Record_head head;
+            memcpy(&head, slot.data, sizeof(head));
+            size_t n = Recorder::slots_for(head.len);
+            bool complete = head.len <= Recorder::MAX_RECORD && head.source < header->source_count;
+            size_t copied = std::min<size_t>(head.len, Recorder::HEAD_PAYLOAD);
+            if (complete) {
+                memcpy(buffer, slot.data + sizeof(head), copied);
+            }
+            for (size_t i = 1; complete && i < n; i++) {
+                const auto &body = slots[(index + i) % count];
+                if (body.tag.load(std::memory_order_acquire) != ((index + i) << 2 | Recorder::TAG_BODY)) {
+                    complete = false;
+                    break;
+                }
+                size_t chunk = std::min(head.len - copied, sizeof(body.data));
+                memcpy(buffer + copied, body.data, chunk);
+                copied += chunk;
+            }
+            if (!complete) {
+                broken++;
+                index++;
+                continue;
+            }
+            if (!started) {
+                first_ns = head.time_ns;
+                started = true;
+            }
+            if (speed > 0) {
+                auto offset = std::chrono::nanoseconds(static_cast<int64_t>((head.time_ns - first_ns) / speed));
+                std::this_thread::sleep_until(start + offset);
+            }
+            replay_record(header->sources[head.source], buffer, head.len);
+            records++;
+            index += n;
+        }
+        LOG_INFO("replay finished: %lu records, %lu broken\n", records, broken);
+        munmap(p, size);
+    }
+
+    void Recorder::start_replay(const std::string &path, double speed) {
+        std::thread(replay_task, path, speed).detach();
+    }
+}  // namespace IO
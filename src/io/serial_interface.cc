@@ -1,12 +1,27 @@
 #include "serial_interface.hpp"
 
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#include "macro_helpers.hpp"
+#include "recorder.hpp"
+#include "serial_protocol.hpp"
 #include "user_lib.hpp"
 
 namespace IO
 {
     Serial_interface::Serial_interface(std::string port_name, int baudrate, int simple_timeout)
-        : serial::Serial(port_name, baudrate, serial::Timeout::simpleTimeout(simple_timeout)),
+        : serial::Serial(replaying ? "" : port_name, baudrate, serial::Timeout::simpleTimeout(simple_timeout)),
           name(port_name) {
+        serial_fd = find_fd(port_name);
+        record_source = recorder.add_source(Source_type::SERIAL, name);
     }
 
     Serial_interface::~Serial_interface() = default;
@@ -21,35 +36,213 @@ namespace IO
         }
     }
 
-    inline int Serial_interface::unpack(uint8_t pkg_id) {
-        if (pkg_id == 1) {
-            memcpy(buffer, read(sizeof(Types::ReceivePacket_IMU)).c_str(), sizeof(Types::ReceivePacket_IMU));
-            UserLib::fromVector(buffer, &imu_pkg);
-            callback(imu_pkg);
-        } else if (pkg_id == 2) {
-            memcpy(buffer, read(sizeof(Types::ReceivePacket_RC_CTRL)).c_str(), sizeof(Types::ReceivePacket_RC_CTRL));
-            UserLib::fromVector(buffer, &rc_pkg);
-            callback(rc_pkg);
+    int Serial_interface::find_fd(const std::string &port_name) {
+        // serial::Serial 不暴露底层 fd，这里通过 /proc/self/fd 找到指向该串口设备的 fd
+        char port_path[PATH_MAX];
+        if (realpath(port_name.c_str(), port_path) == nullptr) {
+            return -1;
+        }
+        DIR *dir = opendir("/proc/self/fd");
+        if (dir == nullptr) {
+            return -1;
+        }
+        int fd = -1;
+        char link[PATH_MAX];
+        while (dirent *entry = readdir(dir)) {
+            std::string path = std::string("/proc/self/fd/") + entry->d_name;
+            ssize_t len = readlink(path.c_str(), link, sizeof(link) - 1);
+            if (len > 0) {
+                link[len] = '\0';
+                if (strcmp(link, port_path) == 0) {
+                    fd = atoi(entry->d_name);
+                    break;
+                }
+            }
+        }
+        closedir(dir);
+        return fd;
+    }
+
+    void Serial_interface::dispatch(uint8_t pkg_id, const uint8_t *data) {
+        if (record_source >= 0) {
+            uint8_t pkg[1 + RX_SIZE];
+            size_t size = packet_size(pkg_id);
+            pkg[0] = pkg_id;
+            memcpy(pkg + 1, data, size);
+            recorder.record(record_source, pkg, 1 + size);
+        }
+        dispatch_packet(pkg_id, data);
+    }
+
+    void Serial_interface::replay(const uint8_t *data, size_t len) {
+        if (len >= 1 && len == 1 + packet_size(data[0])) {
+            dispatch(data[0], data + 1);
+        }
+    }
+
+    ssize_t Serial_interface::fill(bool after_ready) {
+        // 一次只读到缓冲区末尾，下一次调用再从头开始
+        size_t free = RX_SIZE - (rx_tail - rx_head);
+        size_t offset = rx_tail & (RX_SIZE - 1);
+        size_t len = std::min(free, RX_SIZE - offset);
+        if (len == 0) {
+            return 0;
+        }
+        ssize_t n;
+        if (serial_fd >= 0) {
+            // 端口以 VMIN = 0 打开，直接 read 不会阻塞，省去 available() 的 ioctl
+            n = ::read(serial_fd, rx_ring + offset, len);
+            // 断开的设备（拔掉的 USB 串口、关闭的 pty）一直报告可读但读不到数据
+            if ((n == 0 && after_ready) || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+                throw serial::IOException(__FILE__, __LINE__, n == 0 ? EIO : errno);
+            }
+        } else {
+            n = static_cast<ssize_t>(read(rx_ring + offset, std::min(len, available())));
+        }
+        stats.read_syscalls.fetch_add(1, std::memory_order_relaxed);
+        if (n > 0) {
+            rx_tail += n;
+            stats.rx_bytes.fetch_add(n, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    const uint8_t *Serial_interface::contiguous(size_t offset, size_t len) {
+        size_t begin = (rx_head + offset) & (RX_SIZE - 1);
+        if (begin + len <= RX_SIZE) {
+            return rx_ring + begin;
+        }
+        size_t first = RX_SIZE - begin;
+        memcpy(wrap_buffer, rx_ring + begin, first);
+        memcpy(wrap_buffer + first, rx_ring, len - first);
+        return wrap_buffer;
+    }
+
+    ssize_t Serial_interface::parse_frame(uint64_t &packets) {
+        using namespace Serial_protocol;
+        size_t available = rx_tail - rx_head;
+        if (available < HEADER_SIZE) {
+            return 0;
+        }
+        Frame_header header;
+        memcpy(&header, contiguous(0, HEADER_SIZE), HEADER_SIZE);
+        if (header.version != VERSION || crc8(reinterpret_cast<uint8_t *>(&header), HEADER_SIZE - 1) != header.crc8) {
+            stats.crc_errors.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+        size_t size = packet_size(header.id);
+        if (size != 0 && size != header.len) {
+            stats.length_errors.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+        size_t frame_len = HEADER_SIZE + header.len + TAIL_SIZE;
+        if (available < frame_len) {
+            return 0;
+        }
+        const uint8_t *frame = contiguous(0, frame_len);
+        uint16_t crc = crc16(frame, HEADER_SIZE + header.len);
+        if ((crc & 0xff) != frame[frame_len - 2] || (crc >> 8) != frame[frame_len - 1]) {
+            stats.crc_errors.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+        legacy_allowed = false;
+        if (seq_valid) {
+            stats.dropped.fetch_add(static_cast<uint8_t>(header.seq - last_seq - 1), std::memory_order_relaxed);
+        }
+        seq_valid = true;
+        last_seq = header.seq;
+        if (size == 0) {
+            stats.unknown_ids.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            dispatch(header.id, frame + HEADER_SIZE);
+            packets++;
+        }
+        return static_cast<ssize_t>(frame_len);
+    }
+
+    ssize_t Serial_interface::parse_legacy_frame(uint64_t &packets) {
+        using namespace Serial_protocol;
+        size_t available = rx_tail - rx_head;
+        if (available < LEGACY_HEADER_SIZE) {
+            return 0;
+        }
+        const uint8_t *header = contiguous(0, LEGACY_HEADER_SIZE);
+        size_t size = packet_size(header[2]);
+        if ((header[0] | header[1] << 8) != LEGACY_HEADER || size == 0) {
+            return -1;
+        }
+        if (available < LEGACY_HEADER_SIZE + size) {
+            return 0;
+        }
+        uint8_t id = header[2];
+        dispatch(id, contiguous(LEGACY_HEADER_SIZE, size));
+        stats.legacy_packets.fetch_add(1, std::memory_order_relaxed);
+        packets++;
+        return static_cast<ssize_t>(LEGACY_HEADER_SIZE + size);
+    }
+
+    void Serial_interface::parse() {
+        IFDEF(__DEBUG__, auto begin = std::chrono::steady_clock::now());
+        uint64_t packets = 0, skipped = 0;
+        while (rx_tail != rx_head) {
+            uint8_t first = rx_ring[rx_head & (RX_SIZE - 1)];
+            ssize_t n = -1;
+            if (first == Serial_protocol::SOF) {
+                n = parse_frame(packets);
+            } else if (legacy_allowed && first == (Serial_protocol::LEGACY_HEADER & 0xff)) {
+                n = parse_legacy_frame(packets);
+            }
+            if (n == 0) {
+                break;
+            }
+            // 不是合法的帧时只丢弃一个字节，从下一个字节开始重新寻找帧头
+            if (n < 0) {
+                rx_head++;
+                skipped++;
+                continue;
+            }
+            rx_head += n;
+        }
+        stats.packets.fetch_add(packets, std::memory_order_relaxed);
+        stats.skipped_bytes.fetch_add(skipped, std::memory_order_relaxed);
+        IFDEF(
+            __DEBUG__,
+            stats.parse_ns.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - begin)
+                    .count(),
+                std::memory_order_relaxed));
+    }
+
+    bool Serial_interface::on_readable() {
+        try {
+            for (bool ready = true; fill(ready) > 0; ready = false) {
+                parse();
+            }
+        } catch (serial::IOException &e) {
+            LOG_ERR("serail offline!\n");
+            return Status::ERROR;
         }
-        return 0;
+        return Status::OK;
     }
 
     void Serial_interface::task() {
         while (true) {
             try {
                 if (isOpen()) {
-                    read((uint8_t *)&header, 2);
-                    if (header == 0xAA55) {
-                        read((uint8_t *)&header, 1);
-                        unpack(header);
+                    // 等待数据到达后一次读出所有已到达的字节
+                    if (waitReadable() && fill(true) > 0) {
+                        parse();
                     }
                 } else {
                     enumerate_ports();
                     return;
                 }
             } catch (serial::IOException &e) {
-                LOG_ERR("serail offline! end program now\n");
+                // 设备已断开，继续等待只会立即返回可读，与 reactor 模式一样停止该串口的接收
+                LOG_ERR("serail offline! %s stopped\n", getPort().c_str());
                 //exit(-1);
+                return;
             }
         }
     }
@@ -3,42 +3,214 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+#include "recorder.hpp"
 #include "robot.hpp"
-#include "user_lib.hpp"
+#include "robot_type_config.hpp"
 
 namespace IO
 {
-    void Server_socket_interface::task() {
-        while (true) {
-            memset(buffer, 0, sizeof(buffer));
-            sockaddr_in cli_addr;
-            socklen_t cli_addr_len = sizeof(cli_addr);
-            auto n =
-                recvfrom(sockfd, buffer, 256, MSG_WAITALL, (sockaddr *)&cli_addr, &cli_addr_len);
-            if (n > 0) {
-                uint8_t header = buffer[0];
-                if (clients.count(header) == 0) {
-                    LOG_OK("register clients %d\n", header);
-                    clients.insert(std::pair<uint8_t, sockaddr_in>(header, cli_addr));
+    /**
+     * 包长必须在 [min_len, sizeof(T)] 之间，较短的包（例如不带 mode 的自瞄控制包）其余字段保持默认值
+     */
+    template<typename T>
+    static bool decode(T &pkg, const uint8_t *data, size_t len, size_t min_len = sizeof(T)) {
+        if (len < min_len || len > sizeof(T)) {
+            return false;
+        }
+        memcpy(&pkg, data, len);
+        return true;
+    }
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void Server_socket_interface::handle_packet(const uint8_t *data, size_t len, const sockaddr_in *cli_addr) {
+        int64_t t4 = now_ns();
+        // UDP 与共享内存两个接收线程都会调用，回调（如写入单写者 Seqlock 的 GimbalT）要求串行执行
+        std::lock_guard dispatch_guard(rx_lock);
+        recorder.record(record_source, data, len);
+        uint8_t header = data[0];
+        bool valid;
+        switch (header) {
+            case CLOCK_PONG_HEADER: {
+                Clock_pong pong;
+                if (!decode(pong, data, len)) {
+                    stats.rx_invalid.fetch_add(1, std::memory_order_relaxed);
+                } else if (auto sync = clock_syncs[pong.client].load(std::memory_order_acquire)) {
+                    sync->add_sample(pong.t1, pong.t2, pong.t3, t4);
                 }
-                switch (header) {
-                    case 0x37: {
-                        Robot::ReceiveNavigationInfo pkg{};
-                        UserLib::unpack(pkg, buffer);
-                        callback(pkg);
-                        break;
+                // pong 不用于登记 client
+                return;
+            }
+            case Robot::ATTITUDE_QUERY_HEADER: {
+                Robot::Attitude_query query;
+                if (!decode(query, data, len)) {
+                    stats.rx_invalid.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                if (auto sync = clock_syncs[query.client].load(std::memory_order_acquire)) {
+                    query.stamp_ns = sync->to_local(query.stamp_ns);
+                }
+                Attitude_callback::callback_key(query.client, query);
+                // 查询同样不用于登记 client
+                return;
+            }
+            case 0x37: {
+                Robot::ReceiveNavigationInfo pkg{};
+                if ((valid = decode(pkg, data, len))) {
+                    callback(pkg);
+                }
+                break;
+            }
+            default: {
+                if (Tracker_callback::has_callback_key(header)) {
+                    Robot::ReceiveGimbalPacket tracker{};
+                    // 跟踪器 header 不是 client，曝光时间由使用方按对应 client 的时钟换算
+                    if ((valid = decode(tracker, data, len))) {
+                        Tracker_callback::callback_key(header, tracker);
                     }
-                    default: {
-                        Robot::Auto_aim_control vc;
-                        UserLib::unpack(vc, buffer);
-                        callback_key(vc.header, vc);
-                        break;
+                    break;
+                }
+                Robot::Auto_aim_control vc{};
+                if ((valid = decode(vc, data, len, offsetof(Robot::Auto_aim_control, mode)))) {
+                    // 曝光时间映射到本地时钟
+                    auto sync = clock_syncs[vc.header].load(std::memory_order_acquire);
+                    if (vc.capture_ns != 0 && sync != nullptr) {
+                        vc.capture_ns = sync->to_local(vc.capture_ns);
                     }
+                    Aim_callback::callback_key(vc.header, vc);
+                }
+                break;
+            }
+        }
+        if (!valid) {
+            stats.rx_invalid.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::lock_guard guard(tx_lock);
+        if (cli_addr != nullptr && clients.count(header) == 0) {
+            LOG_OK("register clients %d\n", header);
+            clients.insert(std::pair<uint8_t, sockaddr_in>(header, *cli_addr));
+        }
+    }
+
+    int Server_socket_interface::receive_batch(int flags) {
+        for (size_t i = 0; i < RX_BATCH; i++) {
+            // recvmmsg 会改写长度字段，每次调用前恢复
+            rx_msgs[i].msg_hdr.msg_namelen = sizeof(rx_addrs[i]);
+            rx_msgs[i].msg_hdr.msg_controllen = sizeof(rx_controls[i]);
+        }
+        int n = recvmmsg(sockfd, rx_msgs, RX_BATCH, flags, nullptr);
+        if (n <= 0) {
+            return n;
+        }
+        stats.rx_wakeups.fetch_add(1, std::memory_order_relaxed);
+        stats.rx_packets.fetch_add(n, std::memory_order_relaxed);
+        for (int i = 0; i < n; i++) {
+            auto &hdr = rx_msgs[i].msg_hdr;
+            for (cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                    // 内核给出的是累计丢包数
+                    uint32_t overflow;
+                    memcpy(&overflow, CMSG_DATA(cmsg), sizeof(overflow));
+                    stats.rx_overflow.fetch_add(overflow - last_overflow, std::memory_order_relaxed);
+                    last_overflow = overflow;
+                }
+            }
+            if ((hdr.msg_flags & MSG_TRUNC) || rx_msgs[i].msg_len == 0) {
+                stats.rx_invalid.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            handle_packet(rx_buffers[i], rx_msgs[i].msg_len, &rx_addrs[i]);
+        }
+        return n;
+    }
+
+    void Server_socket_interface::task() {
+        while (true) {
+            // 阻塞到至少一个包到达，再顺带取走已经排队的包
+            if (receive_batch(MSG_WAITFORONE) < 0 && errno != EINTR) {
+                LOG_ERR("socket %s recvmmsg error: %s\n", name.c_str(), strerror(errno));
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+    }
+
+    void Server_socket_interface::shm_task() {
+        // 与 UDP 接收线程并行运行，两者的分发由 handle_packet 中的 rx_lock 串行化
+        while (true) {
+            uint8_t data[Shm_link::MAX_MESSAGE];
+            size_t n = shm.receive(data, sizeof(data), 100);
+            if (n > 0) {
+                stats.shm_rx.fetch_add(1, std::memory_order_relaxed);
+                handle_packet(data, n, nullptr);
+            }
+        }
+    }
+
+    void Server_socket_interface::clock_sync_task() {
+        uint16_t seq = 0;
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(Config::CLOCK_SYNC_PERIOD_MS));
+            for (size_t client = 0; client < clock_syncs.size(); client++) {
+                if (clock_syncs[client].load(std::memory_order_acquire) == nullptr) {
+                    continue;
                 }
+                Clock_ping ping{ .client = static_cast<uint8_t>(client), .seq = seq++, .t1 = now_ns() };
+                send_to(client, &ping, sizeof(ping));
+            }
+        }
+    }
+
+    void Server_socket_interface::send_to(uint8_t client, const void *data, size_t len) {
+        std::lock_guard guard(tx_lock);
+        auto addr = clients.find(client);
+        if (addr == clients.end()) {
+            stats.tx_errors.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // 对端在本机且已连接共享内存时不再走回环 UDP
+        if (local_clients[client] && shm.peer_alive()) {
+            if (shm.send(data, len)) {
+                stats.shm_tx.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                stats.shm_dropped.fetch_add(1, std::memory_order_relaxed);
             }
+            return;
+        }
+        auto n = sendto(sockfd, data, len, MSG_CONFIRM, (const sockaddr *)&addr->second, sizeof(addr->second));
+        if (n == -1) {
+            LOG_ERR("error socket send");
+            stats.tx_errors.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            stats.tx_packets.fetch_add(1, std::memory_order_relaxed);
         }
     }
 
+    bool Server_socket_interface::on_readable() {
+        while (true) {
+            int n = receive_batch(MSG_DONTWAIT);
+            if (n < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK ? Status::OK : Status::ERROR;
+            }
+            if (n < static_cast<int>(RX_BATCH)) {
+                return Status::OK;
+            }
+        }
+    }
+
+    void Server_socket_interface::replay(const uint8_t *data, size_t len) {
+        handle_packet(data, len, nullptr);
+    }
+
     Server_socket_interface::Server_socket_interface(std::string name)
         : port_num(11451),
           name(name) {
@@ -52,9 +224,33 @@ namespace IO
         serv_addr.sin_addr.s_addr = INADDR_ANY;
         serv_addr.sin_port = htons(port_num);
 
-        if (bind(sockfd, (sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+        if (!replaying && bind(sockfd, (sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
             LOG_ERR("can't bind socket fd with port number");
         }
+        int enable = 1;
+        if (setsockopt(sockfd, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) < 0) {
+            LOG_ERR("socket %s: can't enable SO_RXQ_OVFL\n", name.c_str());
+        }
+        for (size_t i = 0; i < RX_BATCH; i++) {
+            rx_iovs[i] = { .iov_base = rx_buffers[i], .iov_len = PACKET_SIZE };
+            rx_msgs[i] = {};
+            rx_msgs[i].msg_hdr.msg_name = &rx_addrs[i];
+            rx_msgs[i].msg_hdr.msg_iov = &rx_iovs[i];
+            rx_msgs[i].msg_hdr.msg_iovlen = 1;
+            rx_msgs[i].msg_hdr.msg_control = rx_controls[i];
+        }
+        record_source = recorder.add_source(Source_type::SOCKET, name);
+
+        if (Config::SOCKET_SHM && !replaying) {
+            if (shm.open("/gkd_" + name, Shm_link::Role::ROBOT)) {
+                std::thread(&Server_socket_interface::shm_task, this).detach();
+            } else {
+                LOG_ERR("can't open shared memory /gkd_%s, use UDP only\n", name.c_str());
+            }
+        }
+        if (Config::CLOCK_SYNC_PERIOD_MS > 0 && !replaying) {
+            std::thread(&Server_socket_interface::clock_sync_task, this).detach();
+        }
     }
 
     void Server_socket_interface::add_client(uint8_t header, std::string ip, int port) {
@@ -62,11 +258,19 @@ namespace IO
         client.sin_family = AF_INET;
         client.sin_addr.s_addr = inet_addr(ip.c_str());
         client.sin_port = htons(port);
+        std::lock_guard guard(tx_lock);
         clients.insert(std::pair<uint8_t, sockaddr_in>(header, client));
+        local_clients[header] = (ntohl(client.sin_addr.s_addr) >> 24) == 127;
+        if (clock_syncs[header].load(std::memory_order_relaxed) == nullptr) {
+            clock_syncs[header].store(new Clock_sync, std::memory_order_release);
+        }
         // LOG_INFO("ip %s, port %d\n", ip.c_str(), port);
     }
 
     Server_socket_interface::~Server_socket_interface() {
+        for (auto &sync : clock_syncs) {
+            delete sync.load(std::memory_order_relaxed);
+        }
         close(sockfd);
     }
 }  // namespace IO
@@ -1,14 +1,42 @@
 #include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include <user_lib.hpp>
+#include "io.hpp"
 #include "robot_controller.hpp"
 #include "utils.hpp"
 
 int main(int argc, char **argv) {
+    // --record <file>              把收到的 CAN/串口/UDP 数据记录到 file
+    // --replay <file> [--speed x]  不连接硬件，按 x 倍速（0 为尽快）回放 file
+    std::string record_path, replay_path;
+    double replay_speed = 1.0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--record") == 0) {
+            record_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            replay_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--speed") == 0) {
+            replay_speed = atof(argv[i + 1]);
+        }
+    }
+    if (!replay_path.empty()) {
+        IO::replaying = true;
+    } else if (!record_path.empty()) {
+        IO::recorder.open(record_path);
+    }
+
     Robot::Robot_ctrl robot;
 
     robot.load_hardware();
 
     robot.start_init();
+    // 回调都在 start_init 中注册，回放必须在此之后开始，否则开头的记录没有接收者；
+    // 又必须在 init_join 之前开始，云台初始化要等到 IMU 与电机数据
+    if (IO::replaying) {
+        IO::Recorder::start_replay(replay_path, replay_speed);
+    }
     robot.init_join();
     LOG_INFO("init finished!\n");
 
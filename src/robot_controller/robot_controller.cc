@@ -53,6 +53,7 @@ namespace Robot
         threads.emplace_back(&Device::Dji_referee::task_ui, &referee);
         IFDEF(CONFIG_SENTRY, threads.emplace_back(&Gimbal::GimbalT::task, &gimbal_sentry));
         IFDEF(__DEBUG__, threads.emplace_back(&Logger::task, &logger));
+        threads.emplace_back(&IO::report_task);
     }
 
     void Robot_ctrl::join() {
@@ -61,9 +62,23 @@ namespace Robot
     }
 
     void Robot_ctrl::load_hardware() {
+        if (Config::IO_REACTOR) {
+            IO::mode = IO::Mode::REACTOR;
+            IO::reactor.start(Config::IO_REACTOR_THREADS, Config::IO_REACTOR_CPU);
+        }
         for (auto& name : Config::CanInitList) {
             IO::io<CAN>.insert(name);
         }
+        for (auto& name : Config::CanFdList) {
+            if (auto can = IO::io<CAN>[name]) {
+                can->enable_fd();
+            }
+        }
+        for (auto& [name, period_us] : Config::CanTxPeriodList) {
+            Hardware::DJIMotorManager::set_tx_period(name, std::chrono::microseconds(period_us));
+        }
+        Hardware::DJIMotorManager::set_tx_on_commit(
+            Config::CAN_TX_ON_COMMIT, std::chrono::microseconds(Config::CAN_TX_COALESCE_US));
         for (auto& [name, baud_rate, simple_timeout] : Config::SerialInitList) {
             IO::io<SERIAL>.insert(name, baud_rate, simple_timeout);
         }
@@ -1,6 +1,7 @@
 #include "bullet_solver.hpp"
 
-#include "cmath"
+#include <algorithm>
+#include <cmath>
 
 namespace Control
 {
@@ -30,6 +31,20 @@ namespace Control
         return resistance_coff;
     }
 
+    void BulletSolver::setBulletSpeed(double bullet_speed) {
+        // 阻力系数只随弹速变化，弹速不变时沿用上一次的结果
+        if (bullet_speed == bullet_speed_) {
+            return;
+        }
+        bullet_speed_ = bullet_speed;
+        resistance_coff_ = getResistanceCoefficient(bullet_speed_);
+        if (resistance_coff_ == 0) {
+            resistance_coff_ = 0.001;
+        }
+        warm_ = false;
+        armors_warm_ = 0;
+    }
+
     bool BulletSolver::solve(
         Vec3d pos,
         Vec3d vel,
@@ -40,77 +55,234 @@ namespace Control
         double r2,
         double dz,
         int armors_num) {
-        bullet_speed_ = bullet_speed;
-        resistance_coff_ =
-            getResistanceCoefficient(bullet_speed_) != 0 ? getResistanceCoefficient(bullet_speed_) : 0.001;
-
-        double temp_z = pos.z;
-        double target_rho = std::sqrt(std::pow(pos.x, 2) + std::pow(pos.y, 2));
-        output_yaw_ = std::atan2(pos.y, pos.x);
-        output_pitch_ = std::atan2(temp_z, std::sqrt(std::pow(pos.x, 2) + std::pow(pos.y, 2)));
-        double rough_fly_time =
-            (-std::log(1 - target_rho * resistance_coff_ / (bullet_speed_ * std::cos(output_pitch_)))) /
-            resistance_coff_;
-        selected_armor_ = 0;
-        double r = r1;
-        double z = pos.z;
-        track_target_ = std::abs(v_yaw) < max_track_target_vel_;
-        double switch_armor_angle =
-            track_target_ ? acos(r / target_rho) - M_PI / 12 +
-                                (-acos(r / target_rho) + M_PI / 6) * std::abs(v_yaw) / max_track_target_vel_
-                          : M_PI / 12;
-        if ((((yaw + v_yaw * rough_fly_time) > output_yaw_ + switch_armor_angle) && v_yaw > 0.) ||
-            (((yaw + v_yaw * rough_fly_time) < output_yaw_ - switch_armor_angle) && v_yaw < 0.)) {
-            selected_armor_ = v_yaw > 0. ? -1 : 1;
-            r = armors_num == 4 ? r2 : r1;
-            z = armors_num == 4 ? pos.z + dz : pos.z;
+        setBulletSpeed(bullet_speed);
+        // 迭代在 float 下进行：20m 内 float 的位置误差在微米级，远小于 1mm 的收敛阈值
+        const float k = (float)resistance_coff_;
+        const float v = (float)bullet_speed_;
+        const float g = (float)config_.g;
+        const float px = (float)pos.x, py = (float)pos.y, pz = (float)pos.z;
+        const float vx = (float)vel.x, vy = (float)vel.y, vz = (float)vel.z;
+        const float fyaw = (float)yaw, fv_yaw = (float)v_yaw;
+
+        // 空气阻力模型 x(t) = v cos(p) (1 - e^{-kt}) / k，飞行时间 t = -ln(u) / k，其中 u = 1 - k rho / (v cos(p))
+        // cos(p) = rho / d，所以 u = 1 - k d / v；u <= 0 说明目标超出射程
+        float target_rho = std::sqrt(px * px + py * py);
+        float u = 1 - k * std::sqrt(target_rho * target_rho + pz * pz) / v;
+        if (u <= 0) {
+            warm_ = false;
+            return false;
         }
-        int count{};
-        double error = 999;
-        if (track_target_) {
-            target_pos_.x = pos.x - r * cos(yaw + selected_armor_ * 2 * M_PI / armors_num);
-            target_pos_.y = pos.y - r * sin(yaw + selected_armor_ * 2 * M_PI / armors_num);
-        } else {
-            target_pos_.x = pos.x - r * cos(atan2(pos.y, pos.x));
-            target_pos_.y = pos.y - r * sin(atan2(pos.y, pos.x));
+        float rough_fly_time = -std::log(u) / k;
+        float center_yaw = std::atan2(py, px);
+
+        selected_armor_ = 0;
+        float r = (float)r1;
+        float z = pz;
+        track_target_ = tracksTarget(v_yaw);
+        float max_vel = (float)max_track_target_vel_;
+        float switch_armor_angle =
+            track_target_ ? std::acos(r / target_rho) - (float)M_PI / 12 +
+                                (-std::acos(r / target_rho) + (float)M_PI / 6) * std::abs(fv_yaw) / max_vel
+                          : (float)M_PI / 12;
+        if ((((fyaw + fv_yaw * rough_fly_time) > center_yaw + switch_armor_angle) && fv_yaw > 0.f) ||
+            (((fyaw + fv_yaw * rough_fly_time) < center_yaw - switch_armor_angle) && fv_yaw < 0.f)) {
+            selected_armor_ = fv_yaw > 0.f ? -1 : 1;
+            r = armors_num == 4 ? (float)r2 : (float)r1;
+            z = armors_num == 4 ? pz + (float)dz : pz;
         }
-        target_pos_.z = z;
-        while (error >= 0.001) {
-            output_yaw_ = std::atan2(target_pos_.y, target_pos_.x);
-            output_pitch_ = std::atan2(temp_z, std::sqrt(std::pow(target_pos_.x, 2) + std::pow(target_pos_.y, 2)));
-            target_rho = std::sqrt(std::pow(target_pos_.x, 2) + std::pow(target_pos_.y, 2));
-            fly_time_ = (-std::log(1 - target_rho * resistance_coff_ / (bullet_speed_ * std::cos(output_pitch_)))) /
-                        resistance_coff_;
-            double real_z = (bullet_speed_ * std::sin(output_pitch_) + (config_.g / resistance_coff_)) *
-                                (1 - std::exp(-resistance_coff_ * fly_time_)) / resistance_coff_ -
-                            config_.g * fly_time_ / resistance_coff_;
+        const float armor_angle = selected_armor_ * 2 * (float)M_PI / armors_num;
 
+        // 子弹飞行 t 秒后装甲板的水平位置
+        auto armor_at = [&](float t, float &x, float &y) {
+            float cx = px + vx * t;
+            float cy = py + vy * t;
             if (track_target_) {
-                target_pos_.x = pos.x + vel.x * fly_time_ -
-                                r * cos(yaw + v_yaw * fly_time_ + selected_armor_ * 2 * M_PI / armors_num);
-                target_pos_.y = pos.y + vel.y * fly_time_ -
-                                r * sin(yaw + v_yaw * fly_time_ + selected_armor_ * 2 * M_PI / armors_num);
+                float a = fyaw + fv_yaw * t + armor_angle;
+                x = cx - r * std::cos(a);
+                y = cy - r * std::sin(a);
             } else {
-                double target_pos_after_fly_time[2];
-                target_pos_after_fly_time[0] = pos.x + vel.x * fly_time_;
-                target_pos_after_fly_time[1] = pos.y + vel.y * fly_time_;
-                target_pos_.x = target_pos_after_fly_time[0] -
-                                r * cos(atan2(target_pos_after_fly_time[1], target_pos_after_fly_time[0]));
-                target_pos_.y = target_pos_after_fly_time[1] -
-                                r * sin(atan2(target_pos_after_fly_time[1], target_pos_after_fly_time[0]));
+                float scale = r / std::sqrt(cx * cx + cy * cy);
+                x = cx - scale * cx;
+                y = cy - scale * cy;
             }
-            target_pos_.z = z + vel.z * fly_time_;
+        };
 
-            double target_yaw = std::atan2(target_pos_.y, target_pos_.x);
-            double error_theta = target_yaw - output_yaw_;
-            double error_z = target_pos_.z - real_z;
-            temp_z += error_z;
-            error = std::sqrt(std::pow(error_theta * target_rho, 2) + std::pow(error_z, 2));
-            count++;
+        float fly_time = warm_ ? (float)fly_time_ : 0.f;
+        float tx, ty;
+        armor_at(fly_time, tx, ty);
+        float tz = z + vz * fly_time;
+        float temp_z = warm_ ? tz + (float)pitch_offset_ : pz;
 
-            if (count >= 20 || std::isnan(error))
+        float aim_x = tx, aim_y = ty, aim_z = temp_z;
+        for (int count = 1;; count++) {
+            float rho2 = tx * tx + ty * ty;
+            float rho = std::sqrt(rho2);
+            float d = std::sqrt(rho2 + temp_z * temp_z);
+            u = 1 - k * d / v;
+            if (u <= 0) {
+                warm_ = false;
                 return false;
+            }
+            fly_time = -std::log(u) / k;
+            // e^{-kt} = u，不需要再算 exp
+            float real_z = (v * temp_z / d + g / k) * (1 - u) / k - g * fly_time / k;
+
+            float nx, ny;
+            armor_at(fly_time, nx, ny);
+            float nz = z + vz * fly_time;
+            // 两次瞄准方向的夹角，一次 atan2 代替两次
+            float error_theta = std::atan2(tx * ny - ty * nx, tx * nx + ty * ny);
+            float error_z = nz - real_z;
+
+            aim_x = tx, aim_y = ty, aim_z = temp_z;
+            temp_z += error_z;
+            tx = nx, ty = ny, tz = nz;
+            float error = std::sqrt(error_theta * rho * error_theta * rho + error_z * error_z);
+            if (error < 0.001f) {
+                break;
+            }
+            if (count >= 20 || std::isnan(error)) {
+                warm_ = false;
+                return false;
+            }
         }
+        output_yaw_ = std::atan2(aim_y, aim_x);
+        output_pitch_ = std::atan2(aim_z, std::sqrt(aim_x * aim_x + aim_y * aim_y));
+        target_pos_ = { tx, ty, tz };
+        fly_time_ = fly_time;
+        pitch_offset_ = temp_z - tz;
+        warm_ = true;
         return true;
     }
+
+    int BulletSolver::solveArmors(
+        Vec3d pos,
+        Vec3d vel,
+        double bullet_speed,
+        double yaw,
+        double v_yaw,
+        double r1,
+        double r2,
+        double dz,
+        int armors_num,
+        double gimbal_yaw,
+        double gimbal_pitch,
+        ArmorSolutions &out) {
+        constexpr int N = ArmorSolutions::MAX_ARMORS;
+        setBulletSpeed(bullet_speed);
+        const float k = (float)resistance_coff_;
+        const float v = (float)bullet_speed_;
+        const float g = (float)config_.g;
+        const float px = (float)pos.x, py = (float)pos.y, pz = (float)pos.z;
+        const float vx = (float)vel.x, vy = (float)vel.y, vz = (float)vel.z;
+        const float fv_yaw = (float)v_yaw;
+        const int n = std::clamp(armors_num, 1, N);
+        out.count = n;
+        out.track_target = tracksTarget(v_yaw);
+
+        // 没有可用的初值时，所有装甲板都从目标中心的粗略飞行时间开始迭代
+        float center_u = 1 - k * std::sqrt(px * px + py * py + pz * pz) / v;
+        float rough_fly_time = center_u > 0 ? -std::log(center_u) / k : 0.f;
+        bool warm = armors_warm_ == n;
+
+        // 以下数组的每个下标是一块装甲板，循环体不含分支，已结束的装甲板用选择保持原值
+        float angle[N], r[N], z[N], fly[N], temp_z[N], tx[N], ty[N], tz[N];
+        float aim_x[N], aim_y[N], aim_z[N];
+        bool active[N], converged[N];
+        for (int i = 0; i < N; i++) {
+            // 四块装甲板的目标（步兵、英雄）相邻装甲板的半径与高度不同，与 solve 中切换装甲板的规则一致
+            bool second = n == 4 && (i & 1);
+            angle[i] = (float)yaw + (float)(i % n) * 2 * (float)M_PI / n;
+            r[i] = second ? (float)r2 : (float)r1;
+            z[i] = second ? pz + (float)dz : pz;
+            fly[i] = warm ? armor_fly_time_[i] : rough_fly_time;
+            float a = angle[i] + fv_yaw * fly[i];
+            tx[i] = px + vx * fly[i] - r[i] * std::cos(a);
+            ty[i] = py + vy * fly[i] - r[i] * std::sin(a);
+            tz[i] = z[i] + vz * fly[i];
+            temp_z[i] = tz[i] + (warm ? armor_pitch_offset_[i] : 0.f);
+            aim_x[i] = tx[i], aim_y[i] = ty[i], aim_z[i] = temp_z[i];
+            active[i] = i < n;
+            converged[i] = false;
+        }
+
+        for (int count = 0; count < 20; count++) {
+            bool any_active = false;
+            for (int i = 0; i < N; i++) {
+                float rho2 = tx[i] * tx[i] + ty[i] * ty[i];
+                float rho = std::sqrt(rho2);
+                float d = std::sqrt(rho2 + temp_z[i] * temp_z[i]);
+                float u = 1 - k * d / v;
+                bool reachable = u > 0;
+                u = reachable ? u : 1.f;
+                float t = -std::log(u) / k;
+                float real_z = (v * temp_z[i] / d + g / k) * (1 - u) / k - g * t / k;
+
+                float a = angle[i] + fv_yaw * t;
+                float nx = px + vx * t - r[i] * std::cos(a);
+                float ny = py + vy * t - r[i] * std::sin(a);
+                float nz = z[i] + vz * t;
+                // 小角度下 sin(theta) ≈ theta，水平误差 theta * rho 用叉积近似，省去 atan2
+                float error_h = (tx[i] * ny - ty[i] * nx) / rho;
+                float error_z = nz - real_z;
+                bool done = error_h * error_h + error_z * error_z < 1e-6f;
+
+                bool update = active[i] && reachable;
+                aim_x[i] = update ? tx[i] : aim_x[i];
+                aim_y[i] = update ? ty[i] : aim_y[i];
+                aim_z[i] = update ? temp_z[i] : aim_z[i];
+                fly[i] = update ? t : fly[i];
+                temp_z[i] = update ? temp_z[i] + error_z : temp_z[i];
+                tx[i] = update ? nx : tx[i];
+                ty[i] = update ? ny : ty[i];
+                tz[i] = update ? nz : tz[i];
+                converged[i] = converged[i] || (update && done);
+                active[i] = update && !done;
+                any_active = any_active || active[i];
+            }
+            if (!any_active) {
+                break;
+            }
+        }
+
+        int valid = 0;
+        for (int i = 0; i < n; i++) {
+            out.valid[i] = converged[i];
+            out.fly_time[i] = fly[i];
+            out.yaw[i] = std::atan2(aim_y[i], aim_x[i]);
+            out.pitch[i] = -std::atan2(aim_z[i], std::sqrt(aim_x[i] * aim_x[i] + aim_y[i] * aim_y[i]));
+            out.d_yaw[i] = std::remainder(out.yaw[i] - (float)gimbal_yaw, 2 * (float)M_PI);
+            out.d_pitch[i] = out.pitch[i] - (float)gimbal_pitch;
+            out.x[i] = tx[i], out.y[i] = ty[i], out.z[i] = tz[i];
+            // 装甲板外法向为 -(cos a, sin a)，与指向枪口的 -(x, y) 夹角的余弦
+            float a = angle[i] + fv_yaw * fly[i];
+            out.facing[i] = (std::cos(a) * tx[i] + std::sin(a) * ty[i]) / std::sqrt(tx[i] * tx[i] + ty[i] * ty[i]);
+            armor_fly_time_[i] = fly[i];
+            armor_pitch_offset_[i] = temp_z[i] - tz[i];
+            valid += converged[i];
+        }
+        armors_warm_ = valid == n ? n : 0;
+        return valid;
+    }
+
+    int BulletSolver::selectArmor(const ArmorSolutions &armors) const {
+        // 入射角超过 60° 时装甲板不易击中，也可能被车体遮挡
+        constexpr float MIN_FACING = 0.5f;
+        if (!armors.track_target) {
+            return -1;
+        }
+        int best = -1;
+        float best_cost = 0;
+        for (int i = 0; i < armors.count; i++) {
+            if (!armors.valid[i] || armors.facing[i] < MIN_FACING) {
+                continue;
+            }
+            float cost = std::abs(armors.d_yaw[i]) + std::abs(armors.d_pitch[i]);
+            if (best < 0 || cost < best_cost) {
+                best = i;
+                best_cost = cost;
+            }
+        }
+        return best;
+    }
 }  // namespace Control
\ No newline at end of file
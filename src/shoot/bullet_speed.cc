@@ -0,0 +1,43 @@
+#include "bullet_speed.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Shoot
+{
+    // 裁判系统对 17mm / 42mm 弹丸的合法初速范围之外的数据直接丢弃
+    constexpr fp32 MIN_SPEED = 5.f;
+    constexpr fp32 MAX_SPEED = 40.f;
+    // 前 1 / ALPHA 发按算术平均收敛，之后按 ALPHA 指数加权，约跟踪最近 10 发
+    constexpr fp32 ALPHA = 0.1f;
+    constexpr fp32 INIT_STDDEV = 1.f;
+    // 偏离超过 OUTLIER_SIGMA 倍标准差（且超过 MIN_OUTLIER）的样本视为异常，连续 RESET_REJECTS 发异常则重新估计
+    constexpr fp32 OUTLIER_SIGMA = 4.f;
+    constexpr fp32 MIN_OUTLIER = 0.5f;
+    constexpr uint32_t RESET_REJECTS = 3;
+
+    void Bullet_speed_estimator::add_sample(uint8_t shooter_id, fp32 speed) {
+        if (shooter_id >= SHOOTERS || !(speed >= MIN_SPEED && speed <= MAX_SPEED)) {
+            return;
+        }
+        State &state = states[shooter_id];
+        Estimate &e = state.estimate;
+        fp32 diff = speed - e.speed;
+        if (e.samples > 0 && std::fabs(diff) > std::max(OUTLIER_SIGMA * e.stddev, MIN_OUTLIER)) {
+            if (++state.rejected < RESET_REJECTS) {
+                return;
+            }
+            e.samples = 0;
+        }
+        state.rejected = 0;
+        if (e.samples == 0) {
+            e = Estimate{ .samples = 1, .speed = speed, .stddev = INIT_STDDEV };
+        } else {
+            e.samples++;
+            fp32 alpha = std::max(1.f / (fp32)e.samples, ALPHA);
+            e.speed += alpha * diff;
+            e.stddev = std::sqrt((1 - alpha) * (e.stddev * e.stddev + alpha * diff * diff));
+        }
+        published[shooter_id].store(e);
+    }
+}  // namespace Shoot
@@ -45,6 +45,9 @@ namespace Shoot
         auto timest = std::chrono::steady_clock::now();
         bool isJamFlag = false;
         while (true) {
+            left_friction.update();
+            right_friction.update();
+            trigger.update();
             // LOG_INFO("%d\n", trigger.motor_measure_.given_current);
             if (robot_set->mode == Types::ROBOT_MODE::ROBOT_NO_FORCE) {
                 left_friction.set(0);
@@ -138,6 +141,7 @@ namespace Shoot
                     trigger.set(Config::CONTINUE_TRIGGER_SPEED);
                 }
             }
+            Hardware::DJIMotorManager::commit({ &left_friction, &right_friction, &trigger });
             UserLib::sleep_ms(Config::SHOOT_CONTROL_TIME);
         }
     }
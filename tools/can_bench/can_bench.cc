@@ -0,0 +1,301 @@
+/**
+ * CAN 收发与回调分发的对比测试，新旧两条路径在同一个程序中依次运行。
+ *
+ * 用法：
+ *   can_bench dispatch [-n 帧数]
+ *       纯内存测试，不需要 CAN 网卡：比较旧的 Callback_key（std::map + std::function，count 后再 operator[]）
+ *       与 Can_interface 使用的 Callback_table 每帧的分发耗时
+ *   can_bench io [-i 网卡] [-t 每条路径秒数]
+ *       需要一条有电机反馈的总线，例如 vcan0 上运行 can_sim vcan0:3508:1 vcan0:3508:2 ...
+ *       按 1ms 控制周期在该总线上发送 0x200/0x1FF/0x2FF 三帧命令，同时接收全部反馈，统计每个控制周期的系统调用数与 CPU 时间：
+ *         legacy  每帧一次 read() 的接收线程 + 每帧一次 write()，回调经 Callback_key 分发
+ *         batched Can_interface::task() 的 recvmmsg 接收线程 + Can_interface::send 一次 sendmmsg，回调经 Callback_table 分发
+ *       Can_interface::task() 不会返回，因此先运行 legacy，再运行 batched。
+ *       两条路径都设置相同的内核过滤，只接收 0x201~0x20B；控制周期的 clock_nanosleep 两者相同，不计入系统调用数。
+ */
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "can.hpp"
+#include "io_callback.hpp"
+
+namespace Bench
+{
+    using IO::Rx_time;
+
+    // 反馈帧 ID：3508/2006 为 0x201~0x208，6020 为 0x205~0x20B
+    constexpr uint32_t FIRST_FEEDBACK_ID = 0x201;
+    constexpr uint32_t LAST_FEEDBACK_ID = 0x20B;
+    constexpr canid_t COMMAND_IDS[] = { 0x200, 0x1ff, 0x2ff };
+
+    // 回调只在接收线程中调用，计数用 relaxed 读写而不是原子自增，避免给分发耗时加上一次带锁指令
+    struct Sink
+    {
+        std::atomic<uint64_t> frames{ 0 };
+        uint64_t checksum = 0;
+
+        void operator()(const can_frame &frame, const Rx_time &) {
+            checksum += frame.data[0] ^ frame.can_id;
+            frames.store(frames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    };
+
+    static int64_t clock_ns(clockid_t clock) {
+        timespec ts{};
+        clock_gettime(clock, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+    static int run_dispatch(long n) {
+        std::vector<can_frame> frames(4096);
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<uint32_t> id(FIRST_FEEDBACK_ID, LAST_FEEDBACK_ID);
+        for (auto &frame : frames) {
+            frame.can_id = id(rng);
+            frame.len = 8;
+            frame.data[0] = static_cast<uint8_t>(rng());
+        }
+        Rx_time stamp{};
+
+        Sink legacy_sink, table_sink;
+        IO::Callback_key<uint32_t, can_frame, Rx_time> legacy;
+        IO::Callback_table<CAN_SFF_MASK + 1, can_frame, Rx_time> table;
+        for (uint32_t key = FIRST_FEEDBACK_ID; key <= LAST_FEEDBACK_ID; key++) {
+            legacy.register_callback_key(
+                key, [&legacy_sink](const can_frame &frame, const Rx_time &t) { legacy_sink(frame, t); });
+            table.register_callback_key(
+                key, [&table_sink](const can_frame &frame, const Rx_time &t) { table_sink(frame, t); });
+        }
+
+        auto measure = [&](auto &&dispatch) {
+            int64_t begin = clock_ns(CLOCK_MONOTONIC);
+            for (long i = 0; i < n; i++) {
+                const auto &frame = frames[i & (frames.size() - 1)];
+                dispatch(frame);
+            }
+            return (double)(clock_ns(CLOCK_MONOTONIC) - begin) / n;
+        };
+        double legacy_ns = measure([&](const can_frame &frame) { legacy.callback_key(frame.can_id, frame, stamp); });
+        double table_ns = measure([&](const can_frame &frame) { table.callback_key(frame.can_id, frame, stamp); });
+        if (legacy_sink.checksum != table_sink.checksum) {
+            fprintf(stderr, "can_bench: dispatch results differ\n");
+            return 1;
+        }
+        printf("dispatch %ld frames, %d ids\n", n, LAST_FEEDBACK_ID - FIRST_FEEDBACK_ID + 1);
+        printf("  legacy  Callback_key   %6.2f ns/frame\n", legacy_ns);
+        printf("  batched Callback_table %6.2f ns/frame\n", table_ns);
+        return 0;
+    }
+
+    struct Io_result
+    {
+        uint64_t ticks = 0;
+        uint64_t rx_frames = 0;
+        uint64_t rx_syscalls = 0;
+        uint64_t tx_syscalls = 0;
+        int64_t cpu_ns = 0;
+    };
+
+    static void print_result(const char *name, const Io_result &r) {
+        double ticks = r.ticks ? (double)r.ticks : 1.;
+        printf(
+            "  %-7s %lu ticks, rx %.2f frames/tick, syscalls/tick rx %.2f tx %.2f, cpu %.2f us/tick\n",
+            name,
+            r.ticks,
+            r.rx_frames / ticks,
+            r.rx_syscalls / ticks,
+            r.tx_syscalls / ticks,
+            r.cpu_ns / ticks / 1e3);
+    }
+
+    /**
+     * 以 1ms 绝对截止时间运行 seconds 秒，每个周期调用一次 tick，返回周期数
+     */
+    template<typename F>
+    static uint64_t run_ticks(int seconds, F &&tick) {
+        constexpr int64_t PERIOD = 1000000;
+        int64_t now = clock_ns(CLOCK_MONOTONIC);
+        int64_t end = now + seconds * 1000000000LL;
+        int64_t deadline = now;
+        uint64_t ticks = 0;
+        while (deadline < end) {
+            tick();
+            ticks++;
+            deadline += PERIOD;
+            timespec ts{ .tv_sec = deadline / 1000000000, .tv_nsec = deadline % 1000000000 };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+            }
+        }
+        return ticks;
+    }
+
+    static int open_legacy_socket(const char *iface) {
+        int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+        if (fd < 0) {
+            perror("socket");
+            return -1;
+        }
+        ifreq ifr{};
+        std::strncpy(ifr.ifr_name, iface, IFNAMSIZ - 1);
+        if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0) {
+            fprintf(stderr, "can_bench: no such interface %s\n", iface);
+            close(fd);
+            return -1;
+        }
+        sockaddr_can addr{};
+        addr.can_family = AF_CAN;
+        addr.can_ifindex = ifr.ifr_ifindex;
+        if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            perror("bind");
+            close(fd);
+            return -1;
+        }
+        std::vector<can_filter> filters;
+        for (uint32_t key = FIRST_FEEDBACK_ID; key <= LAST_FEEDBACK_ID; key++) {
+            filters.push_back({ .can_id = key, .can_mask = CAN_SFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG });
+        }
+        setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(), filters.size() * sizeof(can_filter));
+        // 接收线程阻塞读，超时用于检查退出标志
+        timeval timeout{ .tv_sec = 0, .tv_usec = 100000 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return fd;
+    }
+
+    static bool run_legacy(const char *iface, int seconds, Io_result &result) {
+        int fd = open_legacy_socket(iface);
+        if (fd < 0) {
+            return false;
+        }
+        Sink sink;
+        IO::Callback_key<uint32_t, can_frame, Rx_time> callbacks;
+        for (uint32_t key = FIRST_FEEDBACK_ID; key <= LAST_FEEDBACK_ID; key++) {
+            callbacks.register_callback_key(key, [&sink](const can_frame &frame, const Rx_time &t) { sink(frame, t); });
+        }
+        std::atomic<bool> running{ true };
+        std::atomic<uint64_t> rx_syscalls{ 0 };
+        int64_t cpu_begin = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+        // 与批量化之前的 Can_interface::task() 相同：每帧一次 read()
+        std::thread rx([&] {
+            can_frame frame{};
+            while (running.load(std::memory_order_relaxed)) {
+                auto n = read(fd, &frame, sizeof(frame));
+                rx_syscalls.fetch_add(1, std::memory_order_relaxed);
+                if (n == sizeof(frame)) {
+                    // 旧路径不取接收时间
+                    callbacks.callback_key(frame.can_id, frame, Rx_time{});
+                }
+            }
+        });
+        can_frame commands[std::size(COMMAND_IDS)]{};
+        for (size_t i = 0; i < std::size(COMMAND_IDS); i++) {
+            commands[i].can_id = COMMAND_IDS[i];
+            commands[i].len = 8;
+        }
+        uint64_t tx_syscalls = 0;
+        // 与批量化之前的 DJIMotorManager 相同：每帧一次 write()
+        result.ticks = run_ticks(seconds, [&] {
+            for (const auto &frame : commands) {
+                if (write(fd, &frame, sizeof(frame)) < 0) {
+                    perror("write");
+                }
+                tx_syscalls++;
+            }
+        });
+        running = false;
+        rx.join();
+        result.cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_begin;
+        result.rx_frames = sink.frames.load();
+        result.rx_syscalls = rx_syscalls.load();
+        result.tx_syscalls = tx_syscalls;
+        close(fd);
+        return true;
+    }
+
+    static void run_batched(const char *iface, int seconds, Io_result &result) {
+        Sink sink;
+        IO::Can_interface can(iface);
+        for (uint32_t key = FIRST_FEEDBACK_ID; key <= LAST_FEEDBACK_ID; key++) {
+            can.register_callback_key(key, [&sink](const can_frame &frame, const Rx_time &t) { sink(frame, t); });
+        }
+        can_frame commands[std::size(COMMAND_IDS)]{};
+        for (size_t i = 0; i < std::size(COMMAND_IDS); i++) {
+            commands[i].can_id = COMMAND_IDS[i];
+            commands[i].len = 8;
+        }
+        int64_t cpu_begin = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+        uint64_t rx_syscalls = can.stats.rx_syscalls.load();
+        uint64_t tx_syscalls = can.stats.tx_syscalls.load();
+        // task() 不会返回，测试结束后随进程退出
+        std::thread(&IO::Can_interface::task, &can).detach();
+        result.ticks = run_ticks(seconds, [&] { can.send(commands, std::size(commands)); });
+        result.cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_begin;
+        result.rx_frames = sink.frames.load();
+        result.rx_syscalls = can.stats.rx_syscalls.load() - rx_syscalls;
+        result.tx_syscalls = can.stats.tx_syscalls.load() - tx_syscalls;
+        print_result("batched", result);
+        fflush(stdout);
+        _exit(0);
+    }
+
+    static int run_io(const char *iface, int seconds) {
+        printf("io %s, %d s per path, 1 ms tick, %zu command frames per tick\n", iface, seconds, std::size(COMMAND_IDS));
+        Io_result legacy;
+        if (!run_legacy(iface, seconds, legacy)) {
+            return 1;
+        }
+        print_result("legacy", legacy);
+        fflush(stdout);
+        Io_result batched;
+        run_batched(iface, seconds, batched);
+        return 0;
+    }
+}  // namespace Bench
+
+int main(int argc, char **argv) {
+    const char *usage = "usage: %s dispatch [-n frames]\n"
+                        "       %s io [-i iface] [-t seconds]\n";
+    if (argc < 2) {
+        fprintf(stderr, usage, argv[0], argv[0]);
+        return 1;
+    }
+    long frames = 20000000;
+    const char *iface = "vcan0";
+    int seconds = 5;
+    for (int i = 2; i < argc; i++) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            frames = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            iface = argv[++i];
+        } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            seconds = std::atoi(argv[++i]);
+        } else {
+            fprintf(stderr, usage, argv[0], argv[0]);
+            return 1;
+        }
+    }
+    if (std::strcmp(argv[1], "dispatch") == 0 && frames > 0) {
+        return Bench::run_dispatch(frames);
+    }
+    if (std::strcmp(argv[1], "io") == 0 && seconds > 0) {
+        return Bench::run_io(iface, seconds);
+    }
+    fprintf(stderr, usage, argv[0], argv[0]);
+    return 1;
+}
@@ -0,0 +1,507 @@
+/**
+ * vcan 电机模拟器：在没有实车的情况下给 DJIMotorManager / M9025 提供反馈，
+ * 用于测量控制链路的延迟与控制频率。
+ *
+ * 准备 vcan（名字与 Config::CanInitList 一致即可，控制程序无需改动）：
+ *   sudo modprobe vcan
+ *   sudo ip link add dev can0 type vcan && sudo ip link set can0 up
+ *
+ * 用法：
+ *   can_sim [-r 反馈频率Hz] [-p <总线>:<型号>:<id>] [-P 探测周期ms] [-o 探测幅度rpm] [-t 判定阈值]
+ *           <总线>:<型号>:<id> ...
+ *   例：can_sim -p can1:3508:1 can1:3508:1 can1:3508:2 can0:6020:1 can0:9025:1
+ *
+ * 反馈与 ID 规则与 DJIMotor 的构造函数一致：
+ *   M3508/M2006 反馈 0x200 + id，命令 0x200(id 1~4) / 0x1FF(id 5~8)
+ *   M6020       反馈 0x204 + id，命令 0x1FF(id 1~4) / 0x2FF(id 5~7)
+ *   M9025       一问一答，收到 0x140 + id 的命令后立即回复同一 ID
+ * DJI 电调按固定频率周期性发送反馈，与命令是否到达无关。
+ *
+ * 每秒输出每条总线的控制频率（每个发送周期计一次，与该周期包含几帧无关）。
+ *
+ * 反馈到命令的延迟用探测测量：每个探测周期把 -p 指定电机回报的转速叠加一个阶跃（正负交替），
+ * 记录带阶跃的反馈发出的时间，直到该电机的命令相对阶跃前变化超过阈值，即控制程序已经用上这帧反馈算出新的命令。
+ * 探测电机需运行在速度环上（底盘轮、摩擦轮、拨弹盘），且阶跃前命令稳定（如无力模式或摩擦轮匀速），
+ * 一个探测周期内没有反应的计为 missed。
+ */
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace Sim
+{
+    enum class MotorType {
+        M2006 = 2006,
+        M3508 = 3508,
+        M6020 = 6020,
+        M9025 = 9025,
+    };
+
+    /** 一阶模型参数：满量程命令对应的稳态转子转速与时间常数 */
+    struct Model {
+        float cmd_full_scale;   // 满量程命令值
+        float rpm_full_scale;   // 满量程命令下的稳态转子转速 (rpm)
+        float tau;              // 时间常数 (s)
+    };
+
+    static Model model_of(MotorType type) {
+        switch (type) {
+            case MotorType::M2006: return { 10000.f, 20000.f, 0.03f };
+            case MotorType::M3508: return { 16384.f, 9000.f, 0.05f };
+            case MotorType::M6020: return { 16384.f, 320.f, 0.05f };
+            case MotorType::M9025: return { 2048.f, 600.f, 0.08f };
+        }
+        return { 1.f, 0.f, 1.f };
+    }
+
+    struct Motor {
+        MotorType type;
+        int id = 0;
+        Model model{};
+
+        canid_t feedback_id = 0;    // 反馈帧 ID
+        canid_t command_id = 0;     // 命令帧 ID
+        int data_bias = 0;          // 命令帧中的偏移
+
+        int16_t command = 0;
+        float rpm = 0.f;
+        float angle = 0.f;          // 转子角度 (rad)
+        uint8_t temperate = 30;
+        float probe_rpm = 0.f;      // 叠加在回报转速上的探测阶跃
+
+        /** 按 DJIMotor / M9025 的规则计算 ID，非法时返回 false */
+        bool assign_id() {
+            model = model_of(type);
+            switch (type) {
+                case MotorType::M2006:
+                case MotorType::M3508:
+                    if (id < 1 || id > 8) {
+                        return false;
+                    }
+                    feedback_id = 0x200 + id;
+                    command_id = id <= 4 ? 0x200 : 0x1FF;
+                    data_bias = ((id - 1) & 3) << 1;
+                    return true;
+                case MotorType::M6020:
+                    if (id < 1 || id > 7) {
+                        return false;
+                    }
+                    feedback_id = 0x204 + id;
+                    command_id = id <= 4 ? 0x1FF : 0x2FF;
+                    data_bias = ((id - 1) & 3) << 1;
+                    return true;
+                case MotorType::M9025:
+                    if (id < 1 || id > 32) {
+                        return false;
+                    }
+                    feedback_id = command_id = 0x140 + id;
+                    return true;
+            }
+            return false;
+        }
+
+        void step(float dt) {
+            float target = model.rpm_full_scale * command / model.cmd_full_scale;
+            rpm += (target - rpm) * std::min(dt / model.tau, 1.f);
+            angle = std::fmod(angle + rpm * 2.f * M_PIf / 60.f * dt, 2.f * M_PIf);
+            if (angle < 0.f) {
+                angle += 2.f * M_PIf;
+            }
+        }
+
+        can_frame feedback() const {
+            can_frame frame{ .can_id = feedback_id, .len = 8 };
+            auto ecd = static_cast<uint16_t>(angle / (2.f * M_PIf) * 8192.f) & 0x1FFF;
+            auto speed = static_cast<int16_t>(std::lround(rpm + probe_rpm));
+            // 模拟电调回报的实际电流即为命令电流
+            int16_t current = command;
+            if (type == MotorType::M9025) {
+                // 与 M9025::Message::unpack 的小端布局一致
+                auto ecd16 = static_cast<uint16_t>(angle / (2.f * M_PIf) * 65536.f);
+                frame.data[0] = 0xA1;
+                frame.data[1] = temperate;
+                frame.data[2] = current & 0xFF;
+                frame.data[3] = static_cast<uint16_t>(current) >> 8;
+                frame.data[4] = speed & 0xFF;
+                frame.data[5] = static_cast<uint16_t>(speed) >> 8;
+                frame.data[6] = ecd16 & 0xFF;
+                frame.data[7] = ecd16 >> 8;
+                return frame;
+            }
+            frame.data[0] = ecd >> 8;
+            frame.data[1] = ecd & 0xFF;
+            frame.data[2] = static_cast<uint16_t>(speed) >> 8;
+            frame.data[3] = speed & 0xFF;
+            frame.data[4] = static_cast<uint16_t>(current) >> 8;
+            frame.data[5] = current & 0xFF;
+            frame.data[6] = temperate;
+            return frame;
+        }
+    };
+
+    /** 每条总线一个 socket，统计按秒清零 */
+    struct Bus {
+        std::string name;
+        int fd = -1;
+        std::vector<Motor> motors;
+
+        canid_t tick_id = 0;        // 每个发送周期恰好出现一次的命令帧 ID，用于统计控制频率
+
+        int probe = -1;             // 探测电机在 motors 中的下标
+        int16_t probe_base = 0;     // 阶跃生效前的命令
+        bool probe_armed = false;   // 阶跃已设置，等待随下一次反馈发出
+        bool probe_pending = false; // 阶跃已发出，等待命令反应
+        timespec probe_sent{};
+
+        uint64_t feedback_frames = 0;
+        uint64_t command_ticks = 0;
+        uint64_t tx_errors = 0;
+        double latency_sum_us = 0.;
+        double latency_max_us = 0.;
+        uint64_t latency_count = 0;
+        uint64_t probe_missed = 0;
+    };
+
+    struct Probe_config {
+        long period_ms = 100;
+        float step_rpm = 500.f;
+        int threshold = 300;
+    };
+
+    static double diff_us(const timespec &a, const timespec &b) {
+        return (a.tv_sec - b.tv_sec) * 1e6 + (a.tv_nsec - b.tv_nsec) / 1e3;
+    }
+
+    static timespec now() {
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts;
+    }
+
+    static bool open_bus(Bus &bus) {
+        bus.fd = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK, CAN_RAW);
+        if (bus.fd < 0) {
+            perror("socket");
+            return false;
+        }
+        ifreq ifr{};
+        std::strncpy(ifr.ifr_name, bus.name.c_str(), IFNAMSIZ - 1);
+        if (ioctl(bus.fd, SIOCGIFINDEX, &ifr) < 0) {
+            fprintf(stderr, "can_sim: no such interface %s\n", bus.name.c_str());
+            return false;
+        }
+        sockaddr_can addr{};
+        addr.can_family = AF_CAN;
+        addr.can_ifindex = ifr.ifr_ifindex;
+        if (bind(bus.fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            perror("bind");
+            return false;
+        }
+        // 只接收本总线上模拟电机的命令帧
+        std::vector<can_filter> filters;
+        for (const auto &motor : bus.motors) {
+            bool exist = std::any_of(filters.begin(), filters.end(), [&](const can_filter &f) {
+                return f.can_id == motor.command_id;
+            });
+            if (!exist) {
+                filters.push_back({ .can_id = motor.command_id, .can_mask = CAN_SFF_MASK | CAN_EFF_FLAG });
+            }
+        }
+        setsockopt(
+            bus.fd,
+            SOL_CAN_RAW,
+            CAN_RAW_FILTER,
+            filters.data(),
+            static_cast<socklen_t>(filters.size() * sizeof(can_filter)));
+        return true;
+    }
+
+    static void send_frame(Bus &bus, const can_frame &frame) {
+        if (write(bus.fd, &frame, sizeof(frame)) != sizeof(frame)) {
+            bus.tx_errors++;
+            return;
+        }
+        bus.feedback_frames++;
+    }
+
+    static void on_command(Bus &bus, const can_frame &frame, const timespec &stamp, const Probe_config &probe) {
+        if ((frame.can_id & CAN_SFF_MASK) == bus.tick_id) {
+            bus.command_ticks++;
+        }
+        for (auto &motor : bus.motors) {
+            if (motor.command_id != (frame.can_id & CAN_SFF_MASK)) {
+                continue;
+            }
+            if (motor.type == MotorType::M9025) {
+                if (frame.data[0] == 0xA0) {
+                    motor.command = static_cast<int16_t>(frame.data[5] << 8 | frame.data[4]);
+                }
+                // 9025 收到命令即回复
+                send_frame(bus, motor.feedback());
+                continue;
+            }
+            motor.command = static_cast<int16_t>(
+                frame.data[motor.data_bias] << 8 | frame.data[motor.data_bias + 1]);
+        }
+        if (bus.probe_pending && bus.motors[bus.probe].command_id == (frame.can_id & CAN_SFF_MASK) &&
+            std::abs(bus.motors[bus.probe].command - bus.probe_base) > probe.threshold) {
+            double latency = diff_us(stamp, bus.probe_sent);
+            bus.latency_sum_us += latency;
+            bus.latency_max_us = std::max(bus.latency_max_us, latency);
+            bus.latency_count++;
+            bus.probe_pending = false;
+        }
+    }
+
+    static void on_probe(std::vector<Bus> &buses, const Probe_config &probe) {
+        for (auto &bus : buses) {
+            if (bus.probe < 0) {
+                continue;
+            }
+            if (bus.probe_pending) {
+                bus.probe_missed++;
+            }
+            auto &motor = bus.motors[bus.probe];
+            motor.probe_rpm = motor.probe_rpm > 0.f ? -probe.step_rpm : probe.step_rpm;
+            bus.probe_base = motor.command;
+            bus.probe_armed = true;
+            bus.probe_pending = false;
+        }
+    }
+
+    static void on_tick(std::vector<Bus> &buses, float dt) {
+        for (auto &bus : buses) {
+            for (auto &motor : bus.motors) {
+                motor.step(dt);
+                if (motor.type != MotorType::M9025) {
+                    send_frame(bus, motor.feedback());
+                }
+            }
+            if (bus.probe_armed) {
+                bus.probe_sent = now();
+                bus.probe_armed = false;
+                bus.probe_pending = true;
+            }
+        }
+    }
+
+    static void report(std::vector<Bus> &buses, double seconds) {
+        for (auto &bus : buses) {
+            printf(
+                "[%s] control %.1f Hz, feedback %.1f Hz, tx_err %lu",
+                bus.name.c_str(),
+                bus.command_ticks / seconds,
+                bus.feedback_frames / seconds,
+                bus.tx_errors);
+            if (bus.probe >= 0) {
+                double avg = bus.latency_count ? bus.latency_sum_us / bus.latency_count : 0.;
+                printf(
+                    ", fb->cmd avg %.1f us max %.1f us (%lu probes, %lu missed)",
+                    avg,
+                    bus.latency_max_us,
+                    bus.latency_count,
+                    bus.probe_missed);
+            }
+            printf("\n");
+            bus.feedback_frames = bus.command_ticks = bus.tx_errors = bus.latency_count = bus.probe_missed = 0;
+            bus.latency_sum_us = bus.latency_max_us = 0.;
+        }
+        fflush(stdout);
+    }
+
+    static int make_timer(long period_ns) {
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        itimerspec spec{};
+        spec.it_interval = { .tv_sec = period_ns / 1000000000L, .tv_nsec = period_ns % 1000000000L };
+        spec.it_value = spec.it_interval;
+        timerfd_settime(fd, 0, &spec, nullptr);
+        return fd;
+    }
+
+    /** 解析 "can0:3508:1" */
+    static bool parse_motor_arg(const char *arg, char (&name)[IFNAMSIZ], Motor &motor) {
+        int type = 0, id = 0;
+        if (sscanf(arg, "%15[^:]:%d:%d", name, &type, &id) != 3) {
+            return false;
+        }
+        if (type != 2006 && type != 3508 && type != 6020 && type != 9025) {
+            return false;
+        }
+        motor = Motor{ .type = static_cast<MotorType>(type), .id = id };
+        return motor.assign_id();
+    }
+
+    static bool parse_motor(const char *arg, std::vector<Bus> &buses) {
+        char name[IFNAMSIZ]{};
+        Motor motor{};
+        if (!parse_motor_arg(arg, name, motor)) {
+            return false;
+        }
+        auto bus = std::find_if(buses.begin(), buses.end(), [&](const Bus &b) { return b.name == name; });
+        if (bus == buses.end()) {
+            buses.emplace_back().name = name;
+            bus = buses.end() - 1;
+        }
+        for (const auto &other : bus->motors) {
+            if (other.feedback_id == motor.feedback_id ||
+                (other.command_id == motor.command_id && other.data_bias == motor.data_bias &&
+                 motor.type != MotorType::M9025)) {
+                fprintf(stderr, "can_sim: %s conflicts with another motor\n", arg);
+                return false;
+            }
+        }
+        bus->motors.push_back(motor);
+        if (bus->motors.size() == 1 || bus->motors.front().type == MotorType::M9025) {
+            bus->tick_id = motor.command_id;
+        }
+        return true;
+    }
+
+    /** 解析 -p 参数，探测电机需已在电机列表中且不是 9025 */
+    static bool set_probe(const char *arg, std::vector<Bus> &buses) {
+        char name[IFNAMSIZ]{};
+        Motor motor{};
+        if (!parse_motor_arg(arg, name, motor) || motor.type == MotorType::M9025) {
+            return false;
+        }
+        for (auto &bus : buses) {
+            if (bus.name != name) {
+                continue;
+            }
+            for (size_t i = 0; i < bus.motors.size(); i++) {
+                if (bus.motors[i].feedback_id == motor.feedback_id) {
+                    bus.probe = static_cast<int>(i);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    volatile sig_atomic_t running = 1;
+}  // namespace Sim
+
+int main(int argc, char **argv) {
+    using namespace Sim;
+    const char *usage =
+        "usage: %s [-r feedback_hz] [-p <can>:<type>:<id>] [-P probe_ms] [-o probe_rpm] [-t threshold]\n"
+        "          <can>:<2006|3508|6020|9025>:<id> ...\n";
+    int rate = 1000;
+    Probe_config probe;
+    std::vector<const char *> probe_args;
+    std::vector<Bus> buses;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rate = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            probe_args.push_back(argv[++i]);
+        } else if (std::strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            probe.period_ms = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            probe.step_rpm = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            probe.threshold = std::atoi(argv[++i]);
+        } else if (!parse_motor(argv[i], buses)) {
+            fprintf(stderr, usage, argv[0]);
+            return 1;
+        }
+    }
+    if (buses.empty() || rate <= 0 || probe.period_ms <= 0) {
+        fprintf(stderr, usage, argv[0]);
+        return 1;
+    }
+    for (auto arg : probe_args) {
+        if (!set_probe(arg, buses)) {
+            fprintf(stderr, "can_sim: probe %s is not a listed DJI motor\n", arg);
+            return 1;
+        }
+    }
+
+    int epfd = epoll_create1(0);
+    for (size_t i = 0; i < buses.size(); i++) {
+        if (!open_bus(buses[i])) {
+            return 1;
+        }
+        epoll_event ev{ .events = EPOLLIN, .data = { .u64 = i } };
+        epoll_ctl(epfd, EPOLL_CTL_ADD, buses[i].fd, &ev);
+    }
+    const uint64_t TICK = buses.size(), REPORT = buses.size() + 1, PROBE = buses.size() + 2;
+    int tick_fd = make_timer(1000000000L / rate);
+    int report_fd = make_timer(1000000000L);
+    int probe_fd = make_timer(probe.period_ms * 1000000L);
+    epoll_event tick_ev{ .events = EPOLLIN, .data = { .u64 = TICK } };
+    epoll_event report_ev{ .events = EPOLLIN, .data = { .u64 = REPORT } };
+    epoll_event probe_ev{ .events = EPOLLIN, .data = { .u64 = PROBE } };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, tick_fd, &tick_ev);
+    epoll_ctl(epfd, EPOLL_CTL_ADD, report_fd, &report_ev);
+    if (!probe_args.empty()) {
+        epoll_ctl(epfd, EPOLL_CTL_ADD, probe_fd, &probe_ev);
+    }
+
+    signal(SIGINT, [](int) { running = 0; });
+    signal(SIGTERM, [](int) { running = 0; });
+
+    printf("can_sim: %zu bus(es), feedback %d Hz\n", buses.size(), rate);
+    timespec last_tick = now(), last_report = now();
+    epoll_event events[16];
+    while (running) {
+        int n = epoll_wait(epfd, events, 16, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            uint64_t key = events[i].data.u64;
+            uint64_t expirations = 0;
+            if (key == TICK) {
+                read(tick_fd, &expirations, sizeof(expirations));
+                timespec t = now();
+                on_tick(buses, static_cast<float>(diff_us(t, last_tick) / 1e6));
+                last_tick = t;
+            } else if (key == REPORT) {
+                read(report_fd, &expirations, sizeof(expirations));
+                timespec t = now();
+                report(buses, diff_us(t, last_report) / 1e6);
+                last_report = t;
+            } else if (key == PROBE) {
+                read(probe_fd, &expirations, sizeof(expirations));
+                on_probe(buses, probe);
+            } else {
+                auto &bus = buses[key];
+                can_frame frame{};
+                while (read(bus.fd, &frame, sizeof(frame)) == sizeof(frame)) {
+                    on_command(bus, frame, now(), probe);
+                }
+            }
+        }
+    }
+    for (auto &bus : buses) {
+        close(bus.fd);
+    }
+    close(tick_fd);
+    close(report_fd);
+    close(probe_fd);
+    close(epfd);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * DJIMotor 反馈快照的并发压力测试：一个线程以最高速度调用 DJIMotor::unpack()（与 CAN 接收线程相同的写入路径），
+ * 多个线程同时调用 snapshot()，检查读到的每个 Sample 中 Message、Data 与时间戳都来自同一帧反馈。
+ *
+ * 用法：
+ *   seqlock_stress [-t 秒数] [-r 读线程数]
+ *   例：seqlock_stress -t 10 -r 3
+ *
+ * 第 i 帧（从 1 开始）反馈的时间戳为 i 纳秒，ecd / speed_rpm / given_current / temperate 都由 i 决定，
+ * Data 由同样的公式从 Message 计算，因此任意一个字段与时间戳不符即说明读到了撕裂的数据。
+ * 同一个读线程读到的帧序号也不应回退。有错误时返回 1。
+ */
+
+#include <linux/can.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "dji_motor.hpp"
+
+namespace Stress
+{
+    using Hardware::DJIMotor;
+
+    struct Expected
+    {
+        uint16_t ecd;
+        int16_t speed_rpm;
+        int16_t given_current;
+        uint8_t temperate;
+    };
+
+    static Expected expected(uint64_t i) {
+        return Expected{ .ecd = static_cast<uint16_t>(i & 0x1fff),
+                         .speed_rpm = static_cast<int16_t>(i * 7),
+                         .given_current = static_cast<int16_t>(i * 13 + 5),
+                         .temperate = static_cast<uint8_t>(i) };
+    }
+
+    static can_frame encode(uint64_t i) {
+        auto e = expected(i);
+        can_frame frame{};
+        frame.can_id = 0x201;
+        frame.len = 8;
+        frame.data[0] = e.ecd >> 8;
+        frame.data[1] = e.ecd & 0xff;
+        frame.data[2] = static_cast<uint16_t>(e.speed_rpm) >> 8;
+        frame.data[3] = e.speed_rpm & 0xff;
+        frame.data[4] = static_cast<uint16_t>(e.given_current) >> 8;
+        frame.data[5] = e.given_current & 0xff;
+        frame.data[6] = e.temperate;
+        return frame;
+    }
+
+    // 与 DJIMotor::unpack 相同的计算，逐位比较
+    static bool consistent(const DJIMotor::Sample &sample, float radius, float reduction_ratio) {
+        uint64_t i = static_cast<uint64_t>(sample.stamp.time_since_epoch().count());
+        auto e = expected(i);
+        const auto &m = sample.message;
+        const auto &d = sample.data;
+        if (m.ecd != e.ecd || m.speed_rpm != e.speed_rpm || m.given_current != e.given_current ||
+            m.temperate != e.temperate) {
+            return false;
+        }
+        float rotor_angle = DJIMotor::ECD_8192_TO_RAD * static_cast<float>(m.ecd);
+        float rotor_angular_velocity = DJIMotor::RPM_TO_RAD_S * static_cast<float>(m.speed_rpm);
+        float rotor_linear_velocity = rotor_angular_velocity * radius;
+        return d.rotor_angle == rotor_angle && d.rotor_angular_velocity == rotor_angular_velocity &&
+               d.rotor_linear_velocity == rotor_linear_velocity &&
+               d.output_angular_velocity == rotor_angular_velocity * reduction_ratio &&
+               d.output_linear_velocity == rotor_linear_velocity * reduction_ratio;
+    }
+
+    struct Reader_stats
+    {
+        uint64_t reads = 0;
+        uint64_t torn = 0;
+        uint64_t backwards = 0;
+    };
+}  // namespace Stress
+
+int main(int argc, char **argv) {
+    using namespace Stress;
+    int seconds = 5;
+    int readers = 3;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            seconds = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            readers = std::atoi(argv[++i]);
+        } else {
+            seconds = 0;
+            break;
+        }
+    }
+    if (seconds <= 0 || readers <= 0) {
+        fprintf(stderr, "usage: %s [-t seconds] [-r readers]\n", argv[0]);
+        return 1;
+    }
+
+    constexpr float RADIUS = 0.075f;
+    DJIMotor motor(3508, "can0", 1, RADIUS);
+    const float reduction_ratio = motor.data_.reduction_ratio;
+
+    std::atomic<bool> running{ true };
+    std::vector<Reader_stats> stats(readers);
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&, r] {
+            auto &s = stats[r];
+            int64_t last = -1;
+            while (running.load(std::memory_order_relaxed)) {
+                auto sample = motor.snapshot();
+                int64_t i = sample.stamp.time_since_epoch().count();
+                // 写线程还没有写入第一帧
+                if (i == 0) {
+                    continue;
+                }
+                s.reads++;
+                if (!consistent(sample, RADIUS, reduction_ratio)) {
+                    s.torn++;
+                }
+                if (i < last) {
+                    s.backwards++;
+                }
+                last = i;
+            }
+        });
+    }
+
+    uint64_t writes = 0;
+    auto begin = std::chrono::steady_clock::now();
+    auto end = begin + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        // 每次检查时间之间写入一批，避免时钟调用占满写线程
+        for (int k = 0; k < 1024; k++) {
+            writes++;
+            motor.unpack(encode(writes), IO::Rx_time(std::chrono::nanoseconds(writes)));
+        }
+    }
+    running = false;
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    Reader_stats total;
+    for (const auto &s : stats) {
+        total.reads += s.reads;
+        total.torn += s.torn;
+        total.backwards += s.backwards;
+    }
+    printf(
+        "seqlock_stress: %.1f s, %d reader(s), %.2f M writes/s, %.2f M reads/s, torn %lu, backwards %lu\n",
+        elapsed,
+        readers,
+        writes / elapsed / 1e6,
+        total.reads / elapsed / 1e6,
+        total.torn,
+        total.backwards);
+    return total.torn == 0 && total.backwards == 0 ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+/**
+ * 下位机串口模拟器：用 pty 代替 IMU/遥控器串口，按设定频率发送 IMU 与 RC 包，
+ * 用于在没有下位机的情况下运行云台控制并测量串口接收链路。
+ *
+ * 用法：
+ *   serial_sim [-l 链接路径] [-i IMU频率Hz] [-r RC频率Hz] [-m still|sine|spin|step] [-v 1|2]
+ *   例：sudo serial_sim -l /dev/IMU_HERO -i 1000 -r 70 -m sine
+ * 链接路径与 Config::SerialInitList 中的串口名一致即可，控制程序无需改动。
+ * -v 1 使用旧的 0xAA55 帧，默认使用带校验的第 2 版帧（见 include/io/serial_protocol.hpp）。
+ *
+ * 遥控器两个拨杆保持在下位（S1_DOWN/S2_DOWN），使机器人处于可控状态。
+ *
+ * 每秒输出实际发送的包数，并从控制程序每秒刷新的 /tmp/gkd_io_stats 中读取
+ * 该串口的收包数、每包解析耗时、CRC 错误与丢包，两者之差即为主机侧丢失的包。
+ */
+
+#include <fcntl.h>
+#include <pty.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "serial_protocol.hpp"
+#include "types.hpp"
+
+namespace Sim
+{
+    enum class Profile {
+        STILL,  // 静止
+        SINE,   // yaw ±30°、pitch ±10° 的 0.5Hz 正弦摆动
+        SPIN,   // yaw 以 360°/s 匀速旋转
+        STEP,   // yaw 每秒在 0° 与 30° 之间阶跃
+    };
+
+    static bool parse_profile(const char *name, Profile &profile) {
+        const std::map<std::string, Profile> names = {
+            { "still", Profile::STILL }, { "sine", Profile::SINE }, { "spin", Profile::SPIN }, { "step", Profile::STEP }
+        };
+        auto p = names.find(name);
+        if (p == names.end()) {
+            return false;
+        }
+        profile = p->second;
+        return true;
+    }
+
+    /** 角度单位为度，角速度单位与下位机一致（毫度每秒） */
+    static Types::ReceivePacket_IMU imu_at(Profile profile, double t) {
+        Types::ReceivePacket_IMU imu{};
+        constexpr double w = 2 * M_PI * 0.5;
+        switch (profile) {
+            case Profile::STILL: break;
+            case Profile::SINE:
+                imu.yaw = static_cast<float>(30 * std::sin(w * t));
+                imu.pitch = static_cast<float>(10 * std::sin(w * t));
+                imu.yaw_v = static_cast<float>(30 * w * std::cos(w * t) * 1000);
+                imu.pitch_v = static_cast<float>(10 * w * std::cos(w * t) * 1000);
+                break;
+            case Profile::SPIN:
+                imu.yaw = static_cast<float>(std::fmod(360 * t + 180, 360) - 180);
+                imu.yaw_v = 360 * 1000;
+                break;
+            case Profile::STEP: imu.yaw = static_cast<int64_t>(t) % 2 ? 30.f : 0.f; break;
+        }
+        return imu;
+    }
+
+    static Types::ReceivePacket_RC_CTRL rc_idle() {
+        Types::ReceivePacket_RC_CTRL rc{};
+        rc.s1 = 2;  // S1_DOWN
+        rc.s2 = 2;  // S2_DOWN
+        return rc;
+    }
+
+    struct Link {
+        int fd = -1;
+        int version = 2;
+        uint8_t seq = 0;
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        uint64_t write_errors = 0;
+
+        template<typename T>
+        void send(uint8_t id, const T &pkg) {
+            uint8_t frame[IO::Serial_protocol::HEADER_SIZE + UINT8_MAX + IO::Serial_protocol::TAIL_SIZE];
+            size_t len;
+            if (version == 1) {
+                frame[0] = IO::Serial_protocol::LEGACY_HEADER & 0xff;
+                frame[1] = IO::Serial_protocol::LEGACY_HEADER >> 8;
+                frame[2] = id;
+                memcpy(frame + 3, &pkg, sizeof(pkg));
+                len = 3 + sizeof(pkg);
+            } else {
+                len = IO::Serial_protocol::encode(frame, id, seq++, &pkg, sizeof(pkg));
+            }
+            // 主机没有及时读取时 pty 缓冲区会写满，此时丢弃该包并计数
+            if (write(fd, frame, len) != static_cast<ssize_t>(len)) {
+                write_errors++;
+                return;
+            }
+            packets++;
+            bytes += len;
+        }
+    };
+
+    /** 读取控制程序写出的统计文件，控制程序未运行（文件超过 2 秒未刷新）时返回空 */
+    static std::map<std::string, double> read_host_stats() {
+        std::map<std::string, double> values;
+        struct stat st{};
+        if (stat("/tmp/gkd_io_stats", &st) < 0 || time(nullptr) - st.st_mtime > 2) {
+            return values;
+        }
+        std::ifstream file("/tmp/gkd_io_stats");
+        std::string key;
+        double value;
+        while (file >> key >> value) {
+            values[key] = value;
+        }
+        return values;
+    }
+
+    volatile sig_atomic_t running = 1;
+}  // namespace Sim
+
+int main(int argc, char **argv) {
+    using namespace Sim;
+    std::string link_path;
+    int imu_rate = 1000, rc_rate = 70, version = 2;
+    Profile profile = Profile::STILL;
+    int opt;
+    while ((opt = getopt(argc, argv, "l:i:r:m:v:")) != -1) {
+        switch (opt) {
+            case 'l': link_path = optarg; break;
+            case 'i': imu_rate = atoi(optarg); break;
+            case 'r': rc_rate = atoi(optarg); break;
+            case 'v': version = atoi(optarg); break;
+            case 'm':
+                if (parse_profile(optarg, profile)) {
+                    break;
+                }
+                [[fallthrough]];
+            default:
+                fprintf(
+                    stderr,
+                    "usage: %s [-l link] [-i imu_hz] [-r rc_hz] [-m still|sine|spin|step] [-v 1|2]\n",
+                    argv[0]);
+                return 1;
+        }
+    }
+    if (imu_rate <= 0 || rc_rate < 0 || rc_rate > imu_rate || (version != 1 && version != 2)) {
+        fprintf(stderr, "serial_sim: invalid rate or version\n");
+        return 1;
+    }
+
+    int master, slave;
+    char slave_name[64];
+    termios tio{};
+    cfmakeraw(&tio);
+    if (openpty(&master, &slave, slave_name, &tio, nullptr) < 0) {
+        perror("openpty");
+        return 1;
+    }
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    if (!link_path.empty()) {
+        unlink(link_path.c_str());
+        if (symlink(slave_name, link_path.c_str()) < 0) {
+            perror("symlink");
+            return 1;
+        }
+    }
+    std::string port = link_path.empty() ? slave_name : link_path;
+    printf("serial_sim: %s -> %s, imu %d Hz, rc %d Hz, protocol v%d\n", port.c_str(), slave_name, imu_rate, rc_rate, version);
+
+    signal(SIGINT, [](int) { running = 0; });
+    signal(SIGTERM, [](int) { running = 0; });
+
+    int tick_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+    long period_ns = 1000000000L / imu_rate;
+    itimerspec spec{};
+    spec.it_interval = { .tv_sec = period_ns / 1000000000L, .tv_nsec = period_ns % 1000000000L };
+    spec.it_value = spec.it_interval;
+    timerfd_settime(tick_fd, 0, &spec, nullptr);
+
+    Link link{ .fd = master, .version = version };
+    timespec start{}, last_report{};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    last_report = start;
+    uint64_t missed = 0, last_packets = 0;
+    double rc_phase = 0;
+    while (running) {
+        uint64_t expirations = 0;
+        if (read(tick_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        missed += expirations - 1;
+        timespec now{};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double t = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+
+        link.send(1, imu_at(profile, t));
+        rc_phase += static_cast<double>(rc_rate) / imu_rate;
+        if (rc_phase >= 1) {
+            rc_phase -= 1;
+            link.send(2, rc_idle());
+        }
+
+        double elapsed = (now.tv_sec - last_report.tv_sec) + (now.tv_nsec - last_report.tv_nsec) / 1e9;
+        if (elapsed >= 1) {
+            uint64_t sent = link.packets - last_packets;
+            printf(
+                "[%s] sent %.0f pkt/s, %lu timer overruns, %lu write errors",
+                port.c_str(),
+                sent / elapsed,
+                missed,
+                link.write_errors);
+            auto host = read_host_stats();
+            std::string key = "serial." + port + ".";
+            if (host.count(key + "packets")) {
+                // 统计文件每秒刷新一次，与本地的一秒窗口不严格对齐，长时间平均后才准确
+                double received = host[key + "packets"];
+                printf(
+                    " | host recv %.0f pkt/s, parse %.0f ns/pkt, crc %.0f, dropped %.0f, lost %.0f",
+                    received,
+                    host[key + "parse_ns_per_packet"],
+                    host[key + "crc_errors"],
+                    host[key + "dropped"],
+                    std::max(0., static_cast<double>(sent) - received));
+            }
+            printf("\n");
+            fflush(stdout);
+            last_packets = link.packets;
+            missed = 0;
+            link.write_errors = 0;
+            last_report = now;
+        }
+    }
+    if (!link_path.empty()) {
+        unlink(link_path.c_str());
+    }
+    close(tick_fd);
+    close(slave);
+    close(master);
+    return 0;
+}
@@ -0,0 +1,514 @@
+/**
+ * 弹道解算的新旧实现对比，在同一组目标轨迹上依次运行：
+ *   baseline     改动前的 BulletSolver::solve（double，每次从目标中心开始迭代，原样复制在 Baseline 命名空间中）
+ *   solve        当前的 BulletSolver::solve（float，上一次的飞行时间与抬枪量作为初值）
+ *   solveArmors  当前的 BulletSolver::solveArmors，一次解算全部装甲板
+ *
+ * 用法：
+ *   solver_bench [-n 轨迹数] [-l 每条轨迹的控制周期数] [-s 随机种子]
+ *   例：solver_bench -n 200 -l 500
+ *
+ * 每条轨迹是一个匀速平移、匀速自转的目标，按 1ms 控制周期连续解算，与云台控制线程调用 solve 的方式相同，
+ * 因此新实现的初值复用也会被测到。每条轨迹对每种实现都使用新的 BulletSolver 对象。
+ *
+ * 误差：对解算给出的 yaw / pitch，用同一个空气阻力模型求子弹水平距离到达装甲板时的时刻（二分到 1e-12 s），
+ * 此时子弹与装甲板的距离即为脱靶量。solve 可能瞄准的装甲板不止一块（切换装甲板），取其中最小的脱靶量；
+ * solveArmors 按下标与对应装甲板比较。reference 一行是 double 下迭代到 1e-9 m 的解，作为脱靶量的下限参考。
+ * 至少一块候选装甲板的参考解收敛、而解算返回失败的次数记为 fail；解算返回了解、而参考解都不收敛（射程边缘）的次数记为 no ref，
+ * 不计入脱靶量。solveArmors 一行的 calls 是调用次数，fail / no ref 按装甲板计。
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "bullet_solver.hpp"
+
+namespace Baseline
+{
+    // 改动前的 Control::BulletSolver，只保留 solve 用到的部分
+    class BulletSolver
+    {
+       public:
+        BulletSolver() {
+            config_ = { .resistance_coff_qd_10 = 0.45,
+                        .resistance_coff_qd_15 = 1.0,
+                        .resistance_coff_qd_16 = 0.7,
+                        .resistance_coff_qd_18 = 0.55,
+                        .resistance_coff_qd_30 = 5.0,
+                        .g = 9.81 };
+            max_track_target_vel_ = 5.0;
+        }
+
+        double getResistanceCoefficient(double bullet_speed) const {
+            // bullet_speed have 5 value:10,15,16,18,30
+            double resistance_coff;
+            if (bullet_speed < 12.5)
+                resistance_coff = config_.resistance_coff_qd_10;
+            else if (bullet_speed < 15.5)
+                resistance_coff = config_.resistance_coff_qd_15;
+            else if (bullet_speed < 17)
+                resistance_coff = config_.resistance_coff_qd_16;
+            else if (bullet_speed < 24)
+                resistance_coff = config_.resistance_coff_qd_18;
+            else
+                resistance_coff = config_.resistance_coff_qd_30;
+            return resistance_coff;
+        }
+
+        bool solve(
+            Vec3d pos,
+            Vec3d vel,
+            double bullet_speed,
+            double yaw,
+            double v_yaw,
+            double r1,
+            double r2,
+            double dz,
+            int armors_num) {
+            bullet_speed_ = bullet_speed;
+            resistance_coff_ =
+                getResistanceCoefficient(bullet_speed_) != 0 ? getResistanceCoefficient(bullet_speed_) : 0.001;
+
+            double temp_z = pos.z;
+            double target_rho = std::sqrt(std::pow(pos.x, 2) + std::pow(pos.y, 2));
+            output_yaw_ = std::atan2(pos.y, pos.x);
+            output_pitch_ = std::atan2(temp_z, std::sqrt(std::pow(pos.x, 2) + std::pow(pos.y, 2)));
+            double rough_fly_time =
+                (-std::log(1 - target_rho * resistance_coff_ / (bullet_speed_ * std::cos(output_pitch_)))) /
+                resistance_coff_;
+            selected_armor_ = 0;
+            double r = r1;
+            double z = pos.z;
+            track_target_ = std::abs(v_yaw) < max_track_target_vel_;
+            double switch_armor_angle =
+                track_target_ ? acos(r / target_rho) - M_PI / 12 +
+                                    (-acos(r / target_rho) + M_PI / 6) * std::abs(v_yaw) / max_track_target_vel_
+                              : M_PI / 12;
+            if ((((yaw + v_yaw * rough_fly_time) > output_yaw_ + switch_armor_angle) && v_yaw > 0.) ||
+                (((yaw + v_yaw * rough_fly_time) < output_yaw_ - switch_armor_angle) && v_yaw < 0.)) {
+                selected_armor_ = v_yaw > 0. ? -1 : 1;
+                r = armors_num == 4 ? r2 : r1;
+                z = armors_num == 4 ? pos.z + dz : pos.z;
+            }
+            int count{};
+            double error = 999;
+            if (track_target_) {
+                target_pos_.x = pos.x - r * cos(yaw + selected_armor_ * 2 * M_PI / armors_num);
+                target_pos_.y = pos.y - r * sin(yaw + selected_armor_ * 2 * M_PI / armors_num);
+            } else {
+                target_pos_.x = pos.x - r * cos(atan2(pos.y, pos.x));
+                target_pos_.y = pos.y - r * sin(atan2(pos.y, pos.x));
+            }
+            target_pos_.z = z;
+            while (error >= 0.001) {
+                output_yaw_ = std::atan2(target_pos_.y, target_pos_.x);
+                output_pitch_ =
+                    std::atan2(temp_z, std::sqrt(std::pow(target_pos_.x, 2) + std::pow(target_pos_.y, 2)));
+                target_rho = std::sqrt(std::pow(target_pos_.x, 2) + std::pow(target_pos_.y, 2));
+                fly_time_ =
+                    (-std::log(1 - target_rho * resistance_coff_ / (bullet_speed_ * std::cos(output_pitch_)))) /
+                    resistance_coff_;
+                double real_z = (bullet_speed_ * std::sin(output_pitch_) + (config_.g / resistance_coff_)) *
+                                    (1 - std::exp(-resistance_coff_ * fly_time_)) / resistance_coff_ -
+                                config_.g * fly_time_ / resistance_coff_;
+
+                if (track_target_) {
+                    target_pos_.x = pos.x + vel.x * fly_time_ -
+                                    r * cos(yaw + v_yaw * fly_time_ + selected_armor_ * 2 * M_PI / armors_num);
+                    target_pos_.y = pos.y + vel.y * fly_time_ -
+                                    r * sin(yaw + v_yaw * fly_time_ + selected_armor_ * 2 * M_PI / armors_num);
+                } else {
+                    double target_pos_after_fly_time[2];
+                    target_pos_after_fly_time[0] = pos.x + vel.x * fly_time_;
+                    target_pos_after_fly_time[1] = pos.y + vel.y * fly_time_;
+                    target_pos_.x = target_pos_after_fly_time[0] -
+                                    r * cos(atan2(target_pos_after_fly_time[1], target_pos_after_fly_time[0]));
+                    target_pos_.y = target_pos_after_fly_time[1] -
+                                    r * sin(atan2(target_pos_after_fly_time[1], target_pos_after_fly_time[0]));
+                }
+                target_pos_.z = z + vel.z * fly_time_;
+
+                double target_yaw = std::atan2(target_pos_.y, target_pos_.x);
+                double error_theta = target_yaw - output_yaw_;
+                double error_z = target_pos_.z - real_z;
+                temp_z += error_z;
+                error = std::sqrt(std::pow(error_theta * target_rho, 2) + std::pow(error_z, 2));
+                count++;
+
+                if (count >= 20 || std::isnan(error))
+                    return false;
+            }
+            return true;
+        }
+
+        double getYaw() const {
+            return output_yaw_;
+        }
+        double getPitch() const {
+            return -output_pitch_;
+        }
+        Vec3d target_pos_{};
+
+       private:
+        Control::BulletSolverConfig config_{};
+        double max_track_target_vel_;
+        double output_yaw_{}, output_pitch_{};
+        double bullet_speed_{}, resistance_coff_{};
+        int selected_armor_;
+        bool track_target_;
+        double fly_time_;
+    };
+}  // namespace Baseline
+
+namespace Bench
+{
+    constexpr double G = 9.81;
+    constexpr double TICK = 0.001;
+
+    struct Trajectory
+    {
+        Vec3d pos, vel;
+        double yaw, v_yaw;
+        double r1, r2, dz;
+        int armors_num;
+        double bullet_speed;
+    };
+
+    // 第 tick 个控制周期时目标的状态
+    struct State
+    {
+        Vec3d pos, vel;
+        double yaw, v_yaw;
+    };
+
+    static State state_at(const Trajectory &tr, int tick) {
+        double t = tick * TICK;
+        return State{ .pos = { tr.pos.x + tr.vel.x * t, tr.pos.y + tr.vel.y * t, tr.pos.z + tr.vel.z * t },
+                      .vel = tr.vel,
+                      .yaw = tr.yaw + tr.v_yaw * t,
+                      .v_yaw = tr.v_yaw };
+    }
+
+    // 一块可能被瞄准的装甲板：track 为 false 时是正对枪口的中心点（solve 不跟踪装甲板时的瞄准点）
+    struct Armor
+    {
+        bool track;
+        double angle;  // 相对 yaw 的角度
+        double r, z;
+    };
+
+    static void armor_at(const State &s, const Armor &armor, double t, double &x, double &y, double &z) {
+        double cx = s.pos.x + s.vel.x * t;
+        double cy = s.pos.y + s.vel.y * t;
+        if (armor.track) {
+            double a = s.yaw + s.v_yaw * t + armor.angle;
+            x = cx - armor.r * std::cos(a);
+            y = cy - armor.r * std::sin(a);
+        } else {
+            double scale = armor.r / std::sqrt(cx * cx + cy * cy);
+            x = cx - scale * cx;
+            y = cy - scale * cy;
+        }
+        z = armor.z + s.vel.z * t;
+    }
+
+    // 第 i 块装甲板，与 solveArmors 的下标一致
+    static Armor armor_index(const Trajectory &tr, const State &s, int i) {
+        bool second = tr.armors_num == 4 && (i & 1);
+        return Armor{ .track = true,
+                      .angle = i * 2 * M_PI / tr.armors_num,
+                      .r = second ? tr.r2 : tr.r1,
+                      .z = second ? s.pos.z + tr.dz : s.pos.z };
+    }
+
+    // solve 可能瞄准的装甲板：跟踪时为当前装甲板与两侧相邻的装甲板，否则为两种半径下的中心点
+    static std::vector<Armor> solve_candidates(const Trajectory &tr, const State &s, bool track) {
+        if (track) {
+            return { armor_index(tr, s, 0), armor_index(tr, s, 1), armor_index(tr, s, tr.armors_num - 1) };
+        }
+        return { Armor{ .track = false, .angle = 0, .r = tr.r1, .z = s.pos.z },
+                 Armor{ .track = false, .angle = 0, .r = tr.armors_num == 4 ? tr.r2 : tr.r1,
+                        .z = tr.armors_num == 4 ? s.pos.z + tr.dz : s.pos.z } };
+    }
+
+    // 以 yaw / pitch（pitch 向上为正）射出的子弹在水平距离第一次到达装甲板时与装甲板的距离。
+    // 子弹减速后远离的目标可能重新超过子弹，因此按 1ms 步长寻找第一次穿越再二分；
+    // 3s 内没有穿越（射程边缘）时取水平距离差最小的时刻
+    static double miss(double yaw, double pitch, double v, double k, const State &s, const Armor &armor) {
+        double x, y, z;
+        auto gap = [&](double t) {
+            armor_at(s, armor, t, x, y, z);
+            return v * std::cos(pitch) * (1 - std::exp(-k * t)) / k - std::sqrt(x * x + y * y);
+        };
+        double lo = 0, hi = -1;
+        double closest = 0, closest_gap = std::abs(gap(0));
+        for (double t = TICK; t < 3; t += TICK) {
+            double g = gap(t);
+            if (g >= 0) {
+                hi = t;
+                break;
+            }
+            if (-g < closest_gap) {
+                closest = t;
+                closest_gap = -g;
+            }
+            lo = t;
+        }
+        double t = closest;
+        if (hi > 0) {
+            while (hi - lo > 1e-12) {
+                double mid = (lo + hi) / 2;
+                (gap(mid) < 0 ? lo : hi) = mid;
+            }
+            t = (lo + hi) / 2;
+        }
+        double s_xy = v * std::cos(pitch) * (1 - std::exp(-k * t)) / k;
+        double h = (v * std::sin(pitch) + G / k) * (1 - std::exp(-k * t)) / k - G * t / k;
+        armor_at(s, armor, t, x, y, z);
+        double dx = s_xy * std::cos(yaw) - x, dy = s_xy * std::sin(yaw) - y, dz = h - z;
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    static double best_miss(double yaw, double pitch, double v, double k, const State &s,
+                            const std::vector<Armor> &armors) {
+        double best = std::numeric_limits<double>::infinity();
+        for (const auto &armor : armors) {
+            best = std::min(best, miss(yaw, pitch, v, k, s, armor));
+        }
+        return best;
+    }
+
+    // 与 solve 相同的不动点迭代，double 下收敛到 1e-9 m
+    static bool reference(const State &s, const Armor &armor, double v, double k, double &yaw, double &pitch) {
+        double x, y, z;
+        armor_at(s, armor, 0, x, y, z);
+        double temp_z = z;
+        for (int count = 0; count < 1000; count++) {
+            double rho = std::sqrt(x * x + y * y);
+            yaw = std::atan2(y, x);
+            pitch = std::atan2(temp_z, rho);
+            double u = 1 - k * rho / (v * std::cos(pitch));
+            if (u <= 0) {
+                return false;
+            }
+            double t = -std::log(u) / k;
+            double real_z = (v * std::sin(pitch) + G / k) * (1 - u) / k - G * t / k;
+            armor_at(s, armor, t, x, y, z);
+            double error_theta = std::remainder(std::atan2(y, x) - yaw, 2 * M_PI);
+            double error_z = z - real_z;
+            temp_z += error_z;
+            if (std::sqrt(error_theta * rho * error_theta * rho + error_z * error_z) < 1e-9) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    struct Stats
+    {
+        const char *name;
+        double ns_per_call = 0;
+        long calls = 0;
+        long fails = 0;
+        long unconverged = 0;  // 返回了解，但参考解不收敛（超出射程）
+        double max_miss = 0;
+        double sum_miss = 0;
+        long hits = 0;
+
+        void add(double m) {
+            max_miss = std::max(max_miss, m);
+            sum_miss += m;
+            hits++;
+        }
+        void print() const {
+            printf("%-12s ", name);
+            if (ns_per_call > 0) {
+                printf("%10.1f ", ns_per_call);
+            } else {
+                printf("%10s ", "-");
+            }
+            printf(
+                "%8ld %8ld %8ld %12.3f %12.3f\n",
+                calls,
+                fails,
+                unconverged,
+                max_miss * 1e3,
+                hits ? sum_miss / hits * 1e3 : 0.);
+        }
+    };
+
+    struct Output
+    {
+        bool ok;
+        double yaw, pitch;
+    };
+
+    template<typename F>
+    static double time_ns(long calls, F &&f) {
+        auto begin = std::chrono::steady_clock::now();
+        f();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - begin).count() / calls;
+    }
+}  // namespace Bench
+
+int main(int argc, char **argv) {
+    using namespace Bench;
+    int trajectories = 200;
+    int ticks = 500;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            trajectories = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            ticks = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else {
+            trajectories = 0;
+            break;
+        }
+    }
+    if (trajectories <= 0 || ticks <= 0) {
+        fprintf(stderr, "usage: %s [-n trajectories] [-l ticks] [-s seed]\n", argv[0]);
+        return 1;
+    }
+
+    // 2~8m 内的目标，自转速度覆盖可跟踪（< 5 rad/s）与只能瞄准中心两种情况；弹速取裁判系统的几档
+    std::mt19937 rng(seed);
+    auto uniform = [&](double lo, double hi) { return std::uniform_real_distribution<double>(lo, hi)(rng); };
+    const double speeds[] = { 10, 15, 16, 18, 30 };
+    std::vector<Trajectory> trs;
+    for (int i = 0; i < trajectories; i++) {
+        double rho = uniform(2, 8), bearing = uniform(-M_PI, M_PI);
+        trs.push_back(Trajectory{ .pos = { rho * std::cos(bearing), rho * std::sin(bearing), uniform(-0.5, 1) },
+                                  .vel = { uniform(-2, 2), uniform(-2, 2), 0 },
+                                  .yaw = uniform(-M_PI, M_PI),
+                                  .v_yaw = uniform(-10, 10),
+                                  .r1 = uniform(0.2, 0.3),
+                                  .r2 = uniform(0.2, 0.3),
+                                  .dz = uniform(-0.1, 0.1),
+                                  .armors_num = rng() % 4 == 0 ? 2 : 4,
+                                  .bullet_speed = speeds[rng() % 5] });
+    }
+
+    const long calls = static_cast<long>(trajectories) * ticks;
+    std::vector<Output> baseline(calls), solve(calls);
+    std::vector<Control::ArmorSolutions> armors(calls);
+
+    Stats baseline_stats{ .name = "baseline" }, solve_stats{ .name = "solve" },
+        armors_stats{ .name = "solveArmors" }, reference_stats{ .name = "reference" };
+
+    // 先全部解算并计时，再统一计算脱靶量
+    baseline_stats.ns_per_call = time_ns(calls, [&] {
+        for (int i = 0; i < trajectories; i++) {
+            const auto &tr = trs[i];
+            Baseline::BulletSolver solver;
+            for (int tick = 0; tick < ticks; tick++) {
+                auto s = state_at(tr, tick);
+                auto &out = baseline[static_cast<long>(i) * ticks + tick];
+                out.ok = solver.solve(s.pos, s.vel, tr.bullet_speed, s.yaw, s.v_yaw, tr.r1, tr.r2, tr.dz, tr.armors_num);
+                out.yaw = solver.getYaw();
+                out.pitch = -solver.getPitch();
+            }
+        }
+    });
+    solve_stats.ns_per_call = time_ns(calls, [&] {
+        for (int i = 0; i < trajectories; i++) {
+            const auto &tr = trs[i];
+            Control::BulletSolver solver;
+            for (int tick = 0; tick < ticks; tick++) {
+                auto s = state_at(tr, tick);
+                auto &out = solve[static_cast<long>(i) * ticks + tick];
+                out.ok = solver.solve(s.pos, s.vel, tr.bullet_speed, s.yaw, s.v_yaw, tr.r1, tr.r2, tr.dz, tr.armors_num);
+                out.yaw = solver.getYaw();
+                out.pitch = -solver.getPitch();
+            }
+        }
+    });
+    armors_stats.ns_per_call = time_ns(calls, [&] {
+        for (int i = 0; i < trajectories; i++) {
+            const auto &tr = trs[i];
+            Control::BulletSolver solver;
+            for (int tick = 0; tick < ticks; tick++) {
+                auto s = state_at(tr, tick);
+                long n = static_cast<long>(i) * ticks + tick;
+                solver.solveArmors(
+                    s.pos, s.vel, tr.bullet_speed, s.yaw, s.v_yaw, tr.r1, tr.r2, tr.dz, tr.armors_num, 0, 0, armors[n]);
+            }
+        }
+    });
+    baseline_stats.calls = solve_stats.calls = armors_stats.calls = reference_stats.calls = calls;
+
+    Control::BulletSolver model;
+    long armor_solutions = 0;
+    for (int i = 0; i < trajectories; i++) {
+        const auto &tr = trs[i];
+        const double k = model.getResistanceCoefficient(tr.bullet_speed);
+        const double v = tr.bullet_speed;
+        for (int tick = 0; tick < ticks; tick++) {
+            long n = static_cast<long>(i) * ticks + tick;
+            auto s = state_at(tr, tick);
+            auto candidates = solve_candidates(tr, s, model.tracksTarget(s.v_yaw));
+
+            // 参考解：候选装甲板中在射程内的取脱靶量最小的一块
+            bool reachable = false;
+            double ref_miss = std::numeric_limits<double>::infinity();
+            for (const auto &armor : candidates) {
+                double yaw, pitch;
+                if (reference(s, armor, v, k, yaw, pitch)) {
+                    reachable = true;
+                    ref_miss = std::min(ref_miss, miss(yaw, pitch, v, k, s, armor));
+                }
+            }
+            if (reachable) {
+                reference_stats.add(ref_miss);
+            }
+
+            for (auto [out, stats] : { std::pair{ &baseline[n], &baseline_stats }, std::pair{ &solve[n], &solve_stats } }) {
+                if (out->ok && !reachable) {
+                    stats->unconverged++;
+                } else if (out->ok) {
+                    stats->add(best_miss(out->yaw, out->pitch, v, k, s, candidates));
+                } else if (reachable) {
+                    stats->fails++;
+                }
+            }
+
+            const auto &a = armors[n];
+            for (int j = 0; j < tr.armors_num; j++) {
+                auto armor = armor_index(tr, s, j);
+                double yaw, pitch;
+                bool converged = reference(s, armor, v, k, yaw, pitch);
+                armor_solutions++;
+                if (a.valid[j] && !converged) {
+                    armors_stats.unconverged++;
+                } else if (a.valid[j]) {
+                    armors_stats.add(miss(a.yaw[j], -a.pitch[j], v, k, s, armor));
+                } else if (converged) {
+                    armors_stats.fails++;
+                }
+            }
+        }
+    }
+
+    printf(
+        "solver_bench: %d trajectories x %d ticks, seed %u, %ld armor solutions\n",
+        trajectories,
+        ticks,
+        seed,
+        armor_solutions);
+    printf(
+        "%-12s %10s %8s %8s %8s %12s %12s\n", "", "ns/call", "calls", "fail", "no ref", "max miss mm", "mean miss mm");
+    reference_stats.print();
+    baseline_stats.print();
+    solve_stats.print();
+    armors_stats.print();
+    return 0;
+}
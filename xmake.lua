@@ -41,4 +41,108 @@ target("GKDControl")
 
     if(is_mode("debug")) then 
         add_defines("__DEBUG__")
-    end
\ No newline at end of file
+    end
+
+-- vcan 电机模拟器，不依赖机器人代码，见 tools/can_sim/can_sim.cc
+target("can_sim")
+    set_kind("binary")
+    set_languages("c++23")
+    add_files("tools/can_sim/*.cc")
+    set_warnings("allextra")
+    set_default(false)
+
+-- IMU/遥控器串口模拟器，见 tools/serial_sim/serial_sim.cc
+target("serial_sim")
+    set_kind("binary")
+    set_languages("c++23")
+    add_files("tools/serial_sim/*.cc")
+    add_includedirs("include/io", "include/device/referee", "include/utils")
+    add_links("util")
+    set_warnings("allextra")
+    set_default(false)
+
+-- DJIMotor 反馈快照的并发压力测试，见 tools/seqlock_stress/seqlock_stress.cc
+target("seqlock_stress")
+    set_kind("binary")
+    set_languages("c++23")
+    add_files(
+        "tools/seqlock_stress/*.cc",
+        "src/device/dji_motor.cc",
+        "src/device/device_base.cc",
+        "src/control/*.cc",
+        "src/io/*.cc",
+        "src/support/*.cc"
+    )
+    add_includedirs(
+        "include",
+        "include/chassis",
+        "include/configs",
+        "include/device",
+        "include/device/referee",
+        "include/gimbal",
+        "include/utils",
+        "include/logger",
+        "./include/control",
+        "./include/robot_controller",
+        "./include/io",
+        "./include/shoot"
+    )
+    add_packages("serial")
+    set_warnings("allextra")
+    add_options("type")
+    set_default(false)
+
+-- CAN 收发与回调分发的新旧路径对比，见 tools/can_bench/can_bench.cc
+target("can_bench")
+    set_kind("binary")
+    set_languages("c++23")
+    add_files(
+        "tools/can_bench/*.cc",
+        "src/io/*.cc",
+        "src/support/*.cc"
+    )
+    add_includedirs(
+        "include",
+        "include/chassis",
+        "include/configs",
+        "include/device",
+        "include/device/referee",
+        "include/gimbal",
+        "include/utils",
+        "include/logger",
+        "./include/control",
+        "./include/robot_controller",
+        "./include/io",
+        "./include/shoot"
+    )
+    add_packages("serial")
+    set_warnings("allextra")
+    add_options("type")
+    set_default(false)
+
+-- 弹道解算的新旧实现在同一组目标轨迹上的耗时与脱靶量对比，见 tools/solver_bench/solver_bench.cc
+target("solver_bench")
+    set_kind("binary")
+    set_languages("c++23")
+    add_files(
+        "tools/solver_bench/*.cc",
+        "src/shoot/bullet_solver.cc"
+    )
+    add_includedirs(
+        "include",
+        "include/chassis",
+        "include/configs",
+        "include/device",
+        "include/device/referee",
+        "include/gimbal",
+        "include/utils",
+        "include/logger",
+        "./include/control",
+        "./include/robot_controller",
+        "./include/io",
+        "./include/shoot"
+    )
+    add_packages("serial")
+    set_warnings("allextra")
+    add_options("type")
+    set_default(false)